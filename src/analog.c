@@ -249,17 +249,28 @@ const char *deadzone_mode_str(int mode)
 }
 
 
-void deadzone_trigger_calc(int *analog, int analog_in)
-{
-    if (current_state.deadzone_triggers > analog_in)
-        *analog = analog_in;
+// [stage][was pressed], compiled in analog_finalise()
+static int trigger_threshold[2][2];
 
-    else
-        analog = 0;
+int deadzone_trigger_calc(int analog_in, int last_mask)
+{   /* Returns which TRIGGER_MASK_* stages are held.
+     *
+     * Each stage is pressed once the trigger passes its threshold, and is only
+     * released once it drops trigger_hysteresis below it.
+     */
+    int mask = 0;
+
+    if (analog_in > trigger_threshold[0][(last_mask & TRIGGER_MASK_HALF) != 0])
+        mask |= TRIGGER_MASK_HALF;
+
+    if (analog_in > trigger_threshold[1][(last_mask & TRIGGER_MASK_FULL) != 0])
+        mask |= TRIGGER_MASK_FULL;
+
+    return mask;
 }
 
 
-void deadzone_mouse_calc(int *x, int *y, int in_x, int in_y)
+void deadzone_mouse_calc(float *x, float *y, int in_x, int in_y)
 {
     vector2d vec2d_input;
     vector2d vec2d_ouput;
@@ -298,7 +309,230 @@ void deadzone_mouse_calc(int *x, int *y, int in_x, int in_y)
         break;
     }
 
-    *x = (int)(vec2d_ouput.x * (float)current_state.deadzone_scale);
-    *y = (int)(vec2d_ouput.y * (float)current_state.deadzone_scale);
+    *x = vec2d_ouput.x * (float)current_state.deadzone_scale;
+    *y = vec2d_ouput.y * (float)current_state.deadzone_scale;
+}
+
+
+
+/* Stick to direction quantiser.
+ *
+ * Instead of running atan2 for every axis event we keep a table of atan()
+ * for the first octant, the rest of the circle is mirrored from that.
+ *
+ * Angles are binary angles: 0 is right, 16384 is down (SDL's y axis points
+ * down), 32768 is left and 49152 is up.
+ */
+
+#define ANALOG_ATAN_STEPS 256
+
+static Uint16 analog_atan_table[ANALOG_ATAN_STEPS + 1];
+
+// Compiled in analog_finalise() so the event path is compare only.
+static Sint64 analog_enter_sq = 0;
+static Sint64 analog_exit_sq = 0;
+static int analog_axis_enter_x = 0;
+static int analog_axis_exit_x = 0;
+static int analog_axis_enter_y = 0;
+static int analog_axis_exit_y = 0;
+static int analog_sector_count = 8;
+static int analog_sector_size = (ANALOG_ANGLE_FULL / 8);
+static int analog_sector_reach = (ANALOG_ANGLE_FULL / 16);
+
+static const int analog_sector_mask_4way[4] = {
+    ANALOG_MASK_RIGHT,
+    ANALOG_MASK_DOWN,
+    ANALOG_MASK_LEFT,
+    ANALOG_MASK_UP,
+};
+
+static const int analog_sector_mask_8way[8] = {
+    ANALOG_MASK_RIGHT,
+    ANALOG_MASK_DOWN | ANALOG_MASK_RIGHT,
+    ANALOG_MASK_DOWN,
+    ANALOG_MASK_DOWN | ANALOG_MASK_LEFT,
+    ANALOG_MASK_LEFT,
+    ANALOG_MASK_UP | ANALOG_MASK_LEFT,
+    ANALOG_MASK_UP,
+    ANALOG_MASK_UP | ANALOG_MASK_RIGHT,
+};
+
+
+void analog_init()
+{
+    for (int i=0; i <= ANALOG_ATAN_STEPS; i++)
+    {
+        analog_atan_table[i] = (Uint16)(
+            atan((double)(i) / (double)(ANALOG_ATAN_STEPS)) * ((double)(ANALOG_ANGLE_FULL / 2) / M_PI) + 0.5);
+    }
+}
+
+
+void analog_finalise()
+{   // compile the thresholds once the config is loaded.
+    int enter = current_state.deadzone_x;
+    int exit = current_state.deadzone_x - current_state.analog_hysteresis;
+
+    if (exit < 0)
+        exit = 0;
+
+    analog_axis_enter_x = enter;
+    analog_axis_exit_x  = exit;
+
+    analog_axis_enter_y = current_state.deadzone_y;
+    analog_axis_exit_y  = current_state.deadzone_y - current_state.analog_hysteresis;
+
+    if (analog_axis_exit_y < 0)
+        analog_axis_exit_y = 0;
+
+    analog_enter_sq = (Sint64)(enter) * (Sint64)(enter);
+    analog_exit_sq  = (Sint64)(exit)  * (Sint64)(exit);
+
+    analog_sector_count = ((current_state.analog_directions == ANALOG_DIR_4WAY) ? 4 : 8);
+    analog_sector_size  = ANALOG_ANGLE_FULL / analog_sector_count;
+    analog_sector_reach = (analog_sector_size / 2) + ANALOG_ANGLE_DEGREES(current_state.analog_angle_hysteresis);
+
+    current_state.left_analog_sector  = -1;
+    current_state.right_analog_sector = -1;
+
+    trigger_threshold[0][0] = current_state.deadzone_triggers;
+    trigger_threshold[0][1] = current_state.deadzone_triggers - current_state.trigger_hysteresis;
+    trigger_threshold[1][0] = current_state.trigger_full;
+    trigger_threshold[1][1] = current_state.trigger_full - current_state.trigger_hysteresis;
+
+    // the full stage can never be easier to hit than the half stage.
+    if (trigger_threshold[1][0] < trigger_threshold[0][0])
+        trigger_threshold[1][0] = trigger_threshold[0][0];
+
+    if (trigger_threshold[1][1] < trigger_threshold[0][1])
+        trigger_threshold[1][1] = trigger_threshold[0][1];
+}
+
+
+int analog_get_directions(const char *str)
+{
+    if (strcasecmp(str, "4way") == 0 || strcasecmp(str, "4") == 0)
+        return ANALOG_DIR_4WAY;
+
+    else if (strcasecmp(str, "8way") == 0 || strcasecmp(str, "8") == 0)
+        return ANALOG_DIR_8WAY;
+
+    // default
+    return ANALOG_DIR_AXIAL;
+}
+
+
+const char *analog_directions_str(int mode)
+{
+    switch(mode)
+    {
+    default:
+    case ANALOG_DIR_AXIAL:
+        return "axial";
+
+    case ANALOG_DIR_4WAY:
+        return "4way";
+
+    case ANALOG_DIR_8WAY:
+        return "8way";
+    }
+}
+
+
+Uint16 analog_angle(int x, int y)
+{
+    int ax = abs(x);
+    int ay = abs(y);
+    int angle;
+
+    if (ax == 0 && ay == 0)
+        return 0;
+
+    if (ay <= ax)
+        angle = analog_atan_table[(ay * ANALOG_ATAN_STEPS) / ax];
+    else
+        angle = (ANALOG_ANGLE_FULL / 4) - analog_atan_table[(ax * ANALOG_ATAN_STEPS) / ay];
+
+    if (x < 0)
+        angle = (ANALOG_ANGLE_FULL / 2) - angle;
+
+    if (y < 0)
+        angle = ANALOG_ANGLE_FULL - angle;
+
+    return (Uint16)(angle);
+}
+
+
+static int analog_axis_mask(int value, int enter, int exit, bool was_neg, bool was_pos, int mask_neg, int mask_pos)
+{
+    if (value < -(was_neg ? exit : enter))
+        return mask_neg;
+
+    if (value > (was_pos ? exit : enter))
+        return mask_pos;
+
+    return 0;
 }
 
+
+int analog_direction_mask(int *sector, int x, int y, int last_mask)
+{   /* Returns which ANALOG_MASK_* directions should be held.
+     *
+     * The stick has to pass the deadzone to enter a direction, but only has to
+     * stay above (deadzone - analog_hysteresis) to keep it. Sectors work the
+     * same way, the stick has to go analog_angle_hysteresis degrees past the
+     * edge of the current sector before it changes.
+     */
+    if (current_state.analog_directions == ANALOG_DIR_AXIAL)
+    {
+        return (
+            analog_axis_mask(x, analog_axis_enter_x, analog_axis_exit_x,
+                (last_mask & ANALOG_MASK_LEFT) != 0, (last_mask & ANALOG_MASK_RIGHT) != 0,
+                ANALOG_MASK_LEFT, ANALOG_MASK_RIGHT) |
+            analog_axis_mask(y, analog_axis_enter_y, analog_axis_exit_y,
+                (last_mask & ANALOG_MASK_UP) != 0, (last_mask & ANALOG_MASK_DOWN) != 0,
+                ANALOG_MASK_UP, ANALOG_MASK_DOWN));
+    }
+
+    Sint64 magnitude_sq = ((Sint64)(x) * (Sint64)(x)) + ((Sint64)(y) * (Sint64)(y));
+
+    if (magnitude_sq < ((*sector < 0) ? analog_enter_sq : analog_exit_sq))
+    {
+        *sector = -1;
+        return 0;
+    }
+
+    Uint16 angle = analog_angle(x, y);
+
+    if (*sector >= 0)
+    {
+        Sint16 offset = (Sint16)(angle - (Uint16)(*sector * analog_sector_size));
+
+        if (abs(offset) > analog_sector_reach)
+            *sector = -1;
+    }
+
+    if (*sector < 0)
+        *sector = ((Uint16)(angle + (analog_sector_size / 2))) / analog_sector_size;
+
+    if (analog_sector_count == 4)
+        return analog_sector_mask_4way[*sector];
+
+    return analog_sector_mask_8way[*sector];
+}
+
+
+int analog_radial_sector(int x, int y, int count)
+{   /* Which of count equal slices the stick points at, 0 is up and they go
+     * round clockwise. Returns -1 while the stick is inside the deadzone.
+     */
+    Sint64 magnitude_sq = ((Sint64)(x) * (Sint64)(x)) + ((Sint64)(y) * (Sint64)(y));
+
+    if (magnitude_sq < analog_enter_sq)
+        return -1;
+
+    // turn it so up is 0, then shift by half a slice so each slice is centered on its direction.
+    Uint16 angle = (Uint16)(analog_angle(x, y) - (ANALOG_ANGLE_FULL * 3 / 4) + (ANALOG_ANGLE_FULL / (count * 2)));
+
+    return (int)(((Uint32)(angle) * (Uint32)(count)) >> 16);
+}
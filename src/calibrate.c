@@ -0,0 +1,543 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+#include "ini.h"
+
+#include <sys/stat.h>
+
+/* Per controller stick calibration.
+ *
+ * When a controller is added we sample the sticks while they are resting to
+ * find the center and how noisy they are, that gives each stick its own inner
+ * deadzone. Sampling runs from the main loop, input keeps working meanwhile.
+ * While the controller is used we keep track of the furthest the stick gets
+ * in each direction, that gives us the outer saturation and lets us correct
+ * sticks that don't reach the corners (square/octagon gates, worn sticks).
+ * Each sector is centred on one of the 8 directions, and the outer radius is
+ * blended between the two nearest sectors so the output doesn't jump when the
+ * stick crosses from one to the next.
+ *
+ * Results are cached per controller GUID so we only have to sample once.
+ */
+
+#define CALIBRATE_FILE "gptokeyb2_calibration.ini"
+#define CALIBRATE_GUID_MAX 33
+#define CALIBRATE_SECTORS 8
+#define CALIBRATE_SECTOR_SIZE (ANALOG_ANGLE_FULL / CALIBRATE_SECTORS)
+#define CALIBRATE_SAMPLE_DELAY 4
+
+// if the stick moves more than this while sampling, somebody is touching it.
+#define CALIBRATE_MAX_NOISE 6000
+#define CALIBRATE_DEADZONE_MIN 500
+#define CALIBRATE_DEADZONE_MARGIN 400
+
+// dont trust the outer radius until the stick has been pushed at least this far.
+#define CALIBRATE_RADIUS_MIN 16384
+// reach full deflection a little before the furthest point we have seen.
+#define CALIBRATE_OUTER_SCALE 0.95f
+
+typedef struct
+{
+    int center_x;
+    int center_y;
+    int deadzone;
+    int radius[CALIBRATE_SECTORS];
+
+    // compiled from radius, where full deflection starts in each direction
+    float outer[CALIBRATE_SECTORS];
+} stick_calibration;
+
+typedef struct _calibration_entry
+{
+    struct _calibration_entry *next;
+    char guid[CALIBRATE_GUID_MAX];
+    bool dirty;
+
+    stick_calibration stick[2];
+} calibration_entry;
+
+typedef struct
+{
+    SDL_GameController *controller;
+    calibration_entry *entry;
+    Uint64 next_us;
+    Uint64 end_us;
+
+    Sint64 total[2][2];
+    int minimum[2][2];
+    int maximum[2][2];
+    int samples;
+} calibrate_session;
+
+static calibrate_session calibrate_sampling;
+
+static calibration_entry *root_calibration = NULL;
+static calibration_entry *active_calibration = NULL;
+static bool calibration_loaded = false;
+static char calibration_dir[1024] = "";
+static char calibration_file[1024] = "";
+
+static const char *calibrate_stick_names[2] = {
+    "left",
+    "right",
+};
+
+
+static void calibrate_compile(stick_calibration *stick)
+{
+    for (int i=0; i < CALIBRATE_SECTORS; i++)
+    {
+        if (stick->radius[i] < CALIBRATE_RADIUS_MIN)
+            stick->outer[i] = 32767.0f;
+        else
+            stick->outer[i] = (float)(stick->radius[i]) * CALIBRATE_OUTER_SCALE;
+    }
+}
+
+
+static calibration_entry *calibrate_find(const char *guid, bool create)
+{
+    calibration_entry *current = root_calibration;
+
+    while (current != NULL)
+    {
+        if (strcmp(current->guid, guid) == 0)
+            return current;
+
+        current = current->next;
+    }
+
+    if (!create)
+        return NULL;
+
+    current = (calibration_entry *)gptk_malloc(sizeof(calibration_entry));
+
+    strncpy(current->guid, guid, CALIBRATE_GUID_MAX-1);
+
+    for (int i=0; i < 2; i++)
+    {
+        current->stick[i].deadzone = -1;
+        calibrate_compile(&current->stick[i]);
+    }
+
+    current->next = root_calibration;
+    root_calibration = current;
+
+    return current;
+}
+
+
+static int calibrate_ini_handler(
+    void* user, const char* section, const char* name, const char* value)
+{
+    (void)user;
+
+    calibration_entry *entry = calibrate_find(section, true);
+
+    for (int i=0; i < 2; i++)
+    {
+        stick_calibration *stick = &entry->stick[i];
+
+        if (!strcasestartswith(name, calibrate_stick_names[i]))
+            continue;
+
+        name += strlen(calibrate_stick_names[i]);
+
+        if (strcasecmp(name, "_center_x") == 0)
+            stick->center_x = atoi(value);
+
+        else if (strcasecmp(name, "_center_y") == 0)
+            stick->center_y = atoi(value);
+
+        else if (strcasecmp(name, "_deadzone") == 0)
+            stick->deadzone = atoi(value);
+
+        // "_radius" from older versions had the sectors starting on the axes, let it relearn.
+        else if (strcasecmp(name, "_gate") == 0)
+        {
+            char *endptr;
+
+            for (int r=0; r < CALIBRATE_SECTORS; r++)
+            {
+                stick->radius[r] = (int)strtol(value, &endptr, 10);
+
+                if (endptr == value)
+                    break;
+
+                value = endptr;
+            }
+
+            calibrate_compile(stick);
+        }
+
+        break;
+    }
+
+    return 1;
+}
+
+
+static void calibrate_load()
+{
+    if (calibration_loaded)
+        return;
+
+    calibration_loaded = true;
+
+    char* env_home = SDL_getenv("HOME");
+    if (env_home)
+    {
+        snprintf(calibration_dir, sizeof(calibration_dir), "%s/.config", env_home);
+        snprintf(calibration_file, sizeof(calibration_file), "%s/%s", calibration_dir, CALIBRATE_FILE);
+    }
+    else
+        snprintf(calibration_file, sizeof(calibration_file), "%s", CALIBRATE_FILE);
+
+    if (access(calibration_file, F_OK) != 0)
+        return;
+
+    if (ini_parse(calibration_file, calibrate_ini_handler, NULL) < 0)
+        printf("Can't load '%s'\n", calibration_file);
+}
+
+
+static void calibrate_save()
+{
+    bool dirty = false;
+    calibration_entry *current = root_calibration;
+
+    while (current != NULL)
+    {
+        dirty |= current->dirty;
+        current = current->next;
+    }
+
+    if (!dirty)
+        return;
+
+    // ~/.config doesn't exist yet on a fresh device.
+    if (strlen(calibration_dir) > 0 && mkdir(calibration_dir, 0755) != 0 && errno != EEXIST)
+        fprintf(stderr, "Unable to create '%s': %s\n", calibration_dir, strerror(errno));
+
+    FILE *fp = fopen(calibration_file, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Unable to save calibration to '%s': %s\n", calibration_file, strerror(errno));
+        return;
+    }
+
+    fprintf(fp, "# gptokeyb2 stick calibration, delete this file to recalibrate.\n");
+
+    current = root_calibration;
+    while (current != NULL)
+    {
+        fprintf(fp, "\n[%s]\n", current->guid);
+
+        for (int i=0; i < 2; i++)
+        {
+            stick_calibration *stick = &current->stick[i];
+
+            fprintf(fp, "%s_center_x = %d\n", calibrate_stick_names[i], stick->center_x);
+            fprintf(fp, "%s_center_y = %d\n", calibrate_stick_names[i], stick->center_y);
+            fprintf(fp, "%s_deadzone = %d\n", calibrate_stick_names[i], stick->deadzone);
+            fprintf(fp, "%s_gate =", calibrate_stick_names[i]);
+
+            for (int r=0; r < CALIBRATE_SECTORS; r++)
+                fprintf(fp, " %d", stick->radius[r]);
+
+            fprintf(fp, "\n");
+        }
+
+        current->dirty = false;
+        current = current->next;
+    }
+
+    fclose(fp);
+}
+
+
+static void calibrate_sample_start(SDL_GameController *controller, calibration_entry *entry)
+{   // samples are taken from the main loop, see calibrate_update().
+    calibrate_session *session = &calibrate_sampling;
+
+    memset(session, 0, sizeof(calibrate_session));
+
+    for (int i=0; i < 2; i++)
+    {
+        for (int a=0; a < 2; a++)
+        {
+            session->minimum[i][a] = 32767;
+            session->maximum[i][a] = -32768;
+        }
+    }
+
+    session->controller = controller;
+    session->entry = entry;
+    session->next_us = timer_now_us();
+    session->end_us = session->next_us + ((Uint64)(current_state.deadzone_calibrate_time) * 1000);
+
+    printf("Calibrating sticks, please don't touch them.\n");
+}
+
+
+static void calibrate_sample(calibrate_session *session)
+{
+    const SDL_GameControllerAxis axes[2][2] = {
+        {SDL_CONTROLLER_AXIS_LEFTX,  SDL_CONTROLLER_AXIS_LEFTY},
+        {SDL_CONTROLLER_AXIS_RIGHTX, SDL_CONTROLLER_AXIS_RIGHTY},
+    };
+
+    for (int i=0; i < 2; i++)
+    {
+        for (int a=0; a < 2; a++)
+        {
+            int value = SDL_GameControllerGetAxis(session->controller, axes[i][a]);
+
+            session->total[i][a] += value;
+
+            if (value < session->minimum[i][a])
+                session->minimum[i][a] = value;
+
+            if (value > session->maximum[i][a])
+                session->maximum[i][a] = value;
+        }
+    }
+
+    session->samples++;
+}
+
+
+static bool calibrate_sample_finish(calibrate_session *session)
+{
+    calibration_entry *entry = session->entry;
+
+    if (session->samples == 0)
+        return false;
+
+    for (int i=0; i < 2; i++)
+    {
+        stick_calibration *stick = &entry->stick[i];
+        int noise = 0;
+        int center[2];
+
+        for (int a=0; a < 2; a++)
+        {
+            center[a] = (int)(session->total[i][a] / session->samples);
+
+            if ((center[a] - session->minimum[i][a]) > noise)
+                noise = center[a] - session->minimum[i][a];
+
+            if ((session->maximum[i][a] - center[a]) > noise)
+                noise = session->maximum[i][a] - center[a];
+        }
+
+        if (noise > CALIBRATE_MAX_NOISE)
+        {
+            printf("Calibration failed, %s stick moved while sampling.\n", calibrate_stick_names[i]);
+            return false;
+        }
+
+        stick->center_x = center[0];
+        stick->center_y = center[1];
+        stick->deadzone = ((noise * 3) / 2) + CALIBRATE_DEADZONE_MARGIN;
+
+        if (stick->deadzone < CALIBRATE_DEADZONE_MIN)
+            stick->deadzone = CALIBRATE_DEADZONE_MIN;
+
+        GPTK2_DEBUG("calibrate: %s center %d, %d noise %d deadzone %d\n",
+            calibrate_stick_names[i], stick->center_x, stick->center_y, noise, stick->deadzone);
+    }
+
+    entry->dirty = true;
+    return true;
+}
+
+
+void calibrate_update()
+{   // called from state_update(), takes a sample whenever one is due.
+    calibrate_session *session = &calibrate_sampling;
+
+    if (session->controller == NULL)
+        return;
+
+    Uint64 now_us = timer_now_us();
+
+    if (now_us < session->next_us)
+        return;
+
+    calibrate_sample(session);
+    session->next_us = now_us + (CALIBRATE_SAMPLE_DELAY * 1000);
+
+    if (now_us < session->end_us)
+        return;
+
+    if (calibrate_sample_finish(session))
+        active_calibration = session->entry;
+
+    session->controller = NULL;
+    session->entry = NULL;
+}
+
+
+Uint64 calibrate_next_deadline()
+{   // when the next sample is due, 0 if not sampling.
+    if (calibrate_sampling.controller == NULL)
+        return 0;
+
+    return calibrate_sampling.next_us;
+}
+
+
+void calibrate_controller(SDL_GameController *controller)
+{
+    char guid[CALIBRATE_GUID_MAX];
+
+    if (!current_state.deadzone_calibrate)
+        return;
+
+    calibrate_load();
+
+    SDL_JoystickGetGUIDString(
+        SDL_JoystickGetGUID(SDL_GameControllerGetJoystick(controller)), guid, sizeof(guid));
+
+    calibration_entry *entry = calibrate_find(guid, false);
+
+    if (entry == NULL || entry->stick[0].deadzone < 0 || entry->stick[1].deadzone < 0)
+    {   // runs uncalibrated until the samples are in.
+        active_calibration = NULL;
+        calibrate_sample_start(controller, calibrate_find(guid, true));
+        return;
+    }
+
+    printf("Using cached calibration for %s\n", guid);
+
+    calibrate_sampling.controller = NULL;
+    active_calibration = entry;
+}
+
+
+void calibrate_controller_removed(SDL_GameController *controller)
+{
+    if (calibrate_sampling.controller == controller)
+    {
+        calibrate_sampling.controller = NULL;
+        calibrate_sampling.entry = NULL;
+    }
+}
+
+
+void calibrate_stick(int stick_id, int *x, int *y)
+{
+    if (active_calibration == NULL)
+        return;
+
+    stick_calibration *stick = &active_calibration->stick[stick_id];
+
+    int cx = *x - stick->center_x;
+    int cy = *y - stick->center_y;
+
+    Sint64 magnitude_sq = ((Sint64)(cx) * (Sint64)(cx)) + ((Sint64)(cy) * (Sint64)(cy));
+    int angle = analog_angle(cx, cy);
+
+    // nearest direction, sector 0 is centred on the right.
+    int sector = ((angle + (CALIBRATE_SECTOR_SIZE / 2)) / CALIBRATE_SECTOR_SIZE) % CALIBRATE_SECTORS;
+
+    if (magnitude_sq > ((Sint64)(stick->radius[sector]) * (Sint64)(stick->radius[sector])))
+    {   // new furthest point in this direction.
+        stick->radius[sector] = (int)sqrt((double)(magnitude_sq));
+
+        if (stick->radius[sector] >= CALIBRATE_RADIUS_MIN)
+        {
+            calibrate_compile(stick);
+            active_calibration->dirty = true;
+        }
+    }
+
+    float radius = sqrtf((float)(magnitude_sq));
+
+    if (radius <= (float)(stick->deadzone))
+    {   // this stick's own deadzone, anything inside it is the middle.
+        *x = 0;
+        *y = 0;
+        return;
+    }
+
+    // blend between the directions either side.
+    int before = angle / CALIBRATE_SECTOR_SIZE;
+    int after = (before + 1) % CALIBRATE_SECTORS;
+    float blend = (float)(angle % CALIBRATE_SECTOR_SIZE) / (float)(CALIBRATE_SECTOR_SIZE);
+    float outer = stick->outer[before] + (stick->outer[after] - stick->outer[before]) * blend;
+
+    /* The edge of this stick's deadzone lines up with the configured
+     * deadzone, and outer with full deflection, so the configured deadzone
+     * still decides where things start but each stick gets its own.
+     */
+    float edge = (float)((current_state.deadzone_x < current_state.deadzone_y) ? current_state.deadzone_x : current_state.deadzone_y);
+    float inner = (float)(stick->deadzone);
+
+    if (outer <= inner + 1.0f)
+        outer = inner + 1.0f;
+
+    float scale = (edge + (radius - inner) * (32767.0f - edge) / (outer - inner)) / radius;
+
+    cx = (int)((float)(cx) * scale);
+    cy = (int)((float)(cy) * scale);
+
+    *x = ((cx < -32768) ? -32768 : ((cx > 32767) ? 32767 : cx));
+    *y = ((cy < -32768) ? -32768 : ((cy > 32767) ? 32767 : cy));
+}
+
+
+void calibrate_quit()
+{
+    calibrate_save();
+
+    calibration_entry *current = root_calibration;
+    calibration_entry *next;
+
+    while (current != NULL)
+    {
+        next = current->next;
+        free(current);
+        current = next;
+    }
+
+    root_calibration = NULL;
+    active_calibration = NULL;
+}
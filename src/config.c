@@ -46,6 +46,7 @@ enum
     CFG_GPTK,
     CFG_CONFIG,
     CFG_CONTROL,
+    CFG_XBOX,
     CFG_OTHER,
 };
 
@@ -108,6 +109,9 @@ const char *gbtn_names[] = {
     "right_analog_left",
     "right_analog_right",
 
+    "l2_full",
+    "r2_full",
+
     // SPECIAL
     "(max)",
 
@@ -123,6 +127,7 @@ const char *act_names[] = {
     "parent",
     "mouse_slow",
     "pop_state",
+    "radial_menu",
     "hold_state",
     "push_state",
     "set_state",
@@ -199,6 +204,28 @@ int special_button_max(int btn)
 }
 
 
+static const char *mouse_movement_str(int mode)
+{
+    switch(mode)
+    {
+    case MOUSE_MOVEMENT_ON:
+        return "mouse_movement";
+
+    case MOUSE_MOVEMENT_FLICK:
+        return "flick_stick";
+
+    case MOUSE_MOVEMENT_SCROLL:
+        return "scroll";
+
+    case MOUSE_MOVEMENT_ABSOLUTE:
+        return "absolute_mouse";
+
+    default:
+        return "parent";
+    }
+}
+
+
 void config_init()
 {   // Setup config structures.
     root_config = (gptokeyb_config*)gptk_malloc(sizeof(gptokeyb_config));
@@ -264,19 +291,78 @@ void config_dump()
     printf("[config]\n");
     printf("repeat_delay = %d\n", current_state.repeat_delay);
     printf("repeat_rate = %d\n", current_state.repeat_rate);
+    printf("kernel_repeat = %s\n", (current_state.kernel_repeat ? "true" : "false" ));
+    printf("output_sink = %s\n", output_sink_str(current_state.output_sink));
+    printf("output_engine = %s\n", output_engine_str(current_state.output_engine));
+
+    if (strlen(output_file) > 0)
+        printf("output_file = \"%s\"\n", output_file);
+
+    printf("output_benchmark = %s\n", (current_state.output_benchmark ? "true" : "false" ));
     printf("mouse_slow_scale = %d\n", current_state.mouse_slow_scale);
+    printf("mouse_delay = %d\n", current_state.mouse_delay);
+    printf("mouse_accel = %s\n", mouse_accel_mode_str(current_state.mouse_accel));
+    printf("mouse_accel_delay = %d\n", current_state.mouse_accel_delay);
+    printf("mouse_accel_time = %d\n", current_state.mouse_accel_time);
+    printf("mouse_accel_max = %d\n", current_state.mouse_accel_max);
+    printf("dpad_mouse_accel = %s\n", mouse_accel_mode_str(current_state.dpad_mouse_accel));
+    printf("dpad_mouse_accel_delay = %d\n", current_state.dpad_mouse_accel_delay);
+    printf("dpad_mouse_accel_time = %d\n", current_state.dpad_mouse_accel_time);
+    printf("dpad_mouse_accel_max = %d\n", current_state.dpad_mouse_accel_max);
     printf("deadzone_mode = %s\n", deadzone_mode_str(current_state.deadzone_mode));
     printf("deadzone_scale = %d\n", current_state.deadzone_scale);
     printf("deadzone_x = %d\n", current_state.deadzone_x);
     printf("deadzone_y = %d\n", current_state.deadzone_y);
     printf("deadzone_triggers = %d\n", current_state.deadzone_triggers);
+    printf("trigger_full = %d\n", current_state.trigger_full);
+    printf("trigger_hysteresis = %d\n", current_state.trigger_hysteresis);
+    printf("xbox_left_deadzone = %d\n", current_state.xbox_left_deadzone);
+    printf("xbox_right_deadzone = %d\n", current_state.xbox_right_deadzone);
+    printf("xbox_anti_deadzone = %d\n", current_state.xbox_anti_deadzone);
+    printf("xbox_curve = %d\n", current_state.xbox_curve);
+    printf("xbox_trigger_deadzone = %d\n", current_state.xbox_trigger_deadzone);
+    printf("xbox_trigger_max = %d\n", current_state.xbox_trigger_max);
+    printf("gyro_mouse = %s\n", (current_state.gyro_mouse ? "true" : "false" ));
+    printf("gyro_scale = %d\n", current_state.gyro_scale);
+    printf("gyro_smoothing = %d\n", current_state.gyro_smoothing);
+    printf("gyro_calibrate_time = %d\n", current_state.gyro_calibrate_time);
+
+    if (strlen(gyro_record_file) > 0)
+        printf("gyro_record = \"%s\"\n", gyro_record_file);
+
+    if (strlen(gyro_replay_file) > 0)
+        printf("gyro_replay = \"%s\"\n", gyro_replay_file);
+
+    printf("touchpad_mouse = %s\n", (current_state.touchpad_mouse ? "true" : "false" ));
+    printf("touchpad_scale = %d\n", current_state.touchpad_scale);
+    printf("touchpad_accel = %d\n", current_state.touchpad_accel);
+    printf("touchpad_scroll_scale = %d\n", current_state.touchpad_scroll_scale);
+    printf("deadzone_calibrate = %s\n", (current_state.deadzone_calibrate ? "true" : "false" ));
+    printf("deadzone_calibrate_time = %d\n", current_state.deadzone_calibrate_time);
     printf("dpad_mouse_normalize = %s\n", (current_state.dpad_mouse_normalize ? "true" : "false" ));
+    printf("flick_turn = %d\n", current_state.flick_turn);
+    printf("flick_time = %d\n", current_state.flick_time);
+    printf("flick_threshold = %d\n", current_state.flick_threshold);
+    printf("flick_tick = %d\n", current_state.flick_tick);
+    printf("scroll_speed = %d\n", current_state.scroll_speed);
+    printf("absolute_width = %d\n", current_state.absolute_width);
+    printf("absolute_height = %d\n", current_state.absolute_height);
+    printf("absolute_smoothing = %d\n", current_state.absolute_smoothing);
+    printf("pwm_period = %d\n", current_state.pwm_period);
+    printf("debounce_time = %d\n", current_state.debounce_time);
+    printf("left_analog_mouse_scale = %d\n", current_state.left_analog_mouse_scale);
+    printf("right_analog_mouse_scale = %d\n", current_state.right_analog_mouse_scale);
+    printf("analog_directions = %s\n", analog_directions_str(current_state.analog_directions));
+    printf("analog_hysteresis = %d\n", current_state.analog_hysteresis);
+    printf("analog_angle_hysteresis = %d\n", current_state.analog_angle_hysteresis);
 
     if (strlen(default_control_name) > 0)
         printf("controls = \"%s\"\n", default_control_name);
 
     printf("\n");
 
+    xbox_dump();
+
     while (current != NULL)
     {
         printf("[%s]\n", current->name);
@@ -288,22 +374,22 @@ void config_dump()
                 (current->right_analog_as_mouse != MOUSE_MOVEMENT_OFF && btn == GBTN_RIGHT_ANALOG_UP))
             {
                 char *gbnt_name;
-                char *gbnt_mode;
+                const char *gbnt_mode;
 
                 if (btn == GBTN_DPAD_UP)
                 {
                     gbnt_name = "dpad";
-                    gbnt_mode = ((current->dpad_as_mouse == MOUSE_MOVEMENT_ON) ? "mouse_movement" : "parent");
+                    gbnt_mode = mouse_movement_str(current->dpad_as_mouse);
                 }
                 else if (btn == GBTN_LEFT_ANALOG_UP)
                 {
                     gbnt_name = "left_analog";
-                    gbnt_mode = ((current->left_analog_as_mouse == MOUSE_MOVEMENT_ON) ? "mouse_movement" : "parent");
+                    gbnt_mode = mouse_movement_str(current->left_analog_as_mouse);
                 }
                 else if (btn == GBTN_RIGHT_ANALOG_UP)
                 {
                     gbnt_name = "right_analog";
-                    gbnt_mode = ((current->right_analog_as_mouse == MOUSE_MOVEMENT_ON) ? "mouse_movement" : "parent");
+                    gbnt_mode = mouse_movement_str(current->right_analog_as_mouse);
                 }
 
                 printf("%s = %s\n", gbnt_name, gbnt_mode);
@@ -332,7 +418,14 @@ void config_dump()
                     printf(" add_ctrl");
             }
 
-            if (current->button[btn].action != 0)
+            if (current->button[btn].action == ACT_RADIAL_MENU)
+            {
+                printf(" %s %s", act_names[ACT_RADIAL_MENU], ((current->button[btn].radial_stick == 0) ? "left_analog" : "right_analog"));
+
+                for (int key=0; key < current->button[btn].radial_count; key++)
+                    printf(" \"%s\"", find_keycode(current->button[btn].radial_keys[key]));
+            }
+            else if (current->button[btn].action != 0)
             {
                 if (current->button[btn].cfg_name != NULL)
                     printf(" %s %s", act_names[current->button[btn].action], current->button[btn].cfg_name);
@@ -344,9 +437,22 @@ void config_dump()
             if (current->button[btn].repeat)
                 printf(" repeat");
 
+            if (current->button[btn].pwm)
+                printf(" pwm");
+
+            for (int zone=0; zone < current->button[btn].zone_count; zone++)
+            {
+                const gptokeyb_zone *zone_data = &current->button[btn].zones[zone];
+
+                printf("; zone %.2f =", (float)(zone_data->threshold) / 32767.0f);
+
+                for (int key=0; key < zone_data->key_count; key++)
+                    printf(" \"%s\"", find_keycode(zone_data->keycodes[key]));
+            }
+
             printf("\n");
 
-            if ((btn == GBTN_Y) || (btn == GBTN_R3) || (btn == GBTN_GUIDE) || (btn == GBTN_DPAD_RIGHT) || (btn == GBTN_LEFT_ANALOG_RIGHT))
+            if ((btn == GBTN_Y) || (btn == GBTN_R3) || (btn == GBTN_GUIDE) || (btn == GBTN_DPAD_RIGHT) || (btn == GBTN_LEFT_ANALOG_RIGHT) || (btn == GBTN_RIGHT_ANALOG_RIGHT))
                 printf("\n");
         }
 
@@ -370,6 +476,8 @@ void config_overlay_clear(gptokeyb_config *current)
         current->button[btn].modifier = 0;
         current->button[btn].action   = ACT_NONE;
         current->button[btn].repeat   = false;
+        current->button[btn].pwm      = false;
+        current->button[btn].zone_count = 0;
     }
 }
 
@@ -385,6 +493,8 @@ void config_overlay_parent(gptokeyb_config *current)
         current->button[btn].modifier = 0;
         current->button[btn].action   = ACT_PARENT;
         current->button[btn].repeat   = false;
+        current->button[btn].pwm      = false;
+        current->button[btn].zone_count = 0;
     }
 }
 
@@ -415,6 +525,12 @@ void config_overlay_named(gptokeyb_config *current, const char *name)
         current->button[btn].modifier = other->button[btn].modifier;
         current->button[btn].action   = other->button[btn].action;
         current->button[btn].repeat   = other->button[btn].repeat;
+        current->button[btn].pwm      = other->button[btn].pwm;
+        current->button[btn].zone_count = other->button[btn].zone_count;
+        current->button[btn].radial_stick = other->button[btn].radial_stick;
+        current->button[btn].radial_count = other->button[btn].radial_count;
+        memcpy(current->button[btn].radial_keys, other->button[btn].radial_keys, sizeof(current->button[btn].radial_keys));
+        memcpy(current->button[btn].zones, other->button[btn].zones, sizeof(current->button[btn].zones));
 
         if (current->button[btn].action >= ACT_STATE_HOLD)
         {
@@ -518,6 +634,21 @@ void set_cfg_config(const char *name, const char *value)
     else if (strcasecmp(name, "repeat_rate") == 0)
         current_state.repeat_rate = atoi_between(value, 16, 3000, SDL_DEFAULT_REPEAT_INTERVAL);
 
+    else if (strcasecmp(name, "kernel_repeat") == 0)
+        current_state.kernel_repeat = atob_default(value, false);
+
+    else if (strcasecmp(name, "output_sink") == 0)
+        current_state.output_sink = output_get_sink(value);
+
+    else if (strcasecmp(name, "output_file") == 0)
+        strncpy(output_file, value, OUTPUT_FILE_MAX-1);
+
+    else if (strcasecmp(name, "output_engine") == 0)
+        current_state.output_engine = output_get_engine(value);
+
+    else if (strcasecmp(name, "output_benchmark") == 0)
+        current_state.output_benchmark = atob_default(value, false);
+
     else if (strcasecmp(name, "mouse_slow_scale") == 0)
         current_state.mouse_slow_scale = atoi_between(value, 1, 100, 50);
 
@@ -542,11 +673,140 @@ void set_cfg_config(const char *name, const char *value)
     else if (strcasecmp(name, "deadzone_triggers") == 0)
         current_state.deadzone_triggers = atoi_between(value, 500, 32768, 3000);
 
+    else if (strcasecmp(name, "trigger_full") == 0)
+        current_state.trigger_full = atoi_between(value, 500, 32767, 30000);
+
+    else if (strcasecmp(name, "trigger_hysteresis") == 0)
+        current_state.trigger_hysteresis = atoi_between(value, 0, 16384, 1000);
+
+    else if (strcasecmp(name, "xbox_left_deadzone") == 0)
+        current_state.xbox_left_deadzone = atoi_between(value, 0, 30000, 0);
+
+    else if (strcasecmp(name, "xbox_right_deadzone") == 0)
+        current_state.xbox_right_deadzone = atoi_between(value, 0, 30000, 0);
+
+    else if (strcasecmp(name, "xbox_anti_deadzone") == 0)
+        current_state.xbox_anti_deadzone = atoi_between(value, 0, 30000, 0);
+
+    else if (strcasecmp(name, "xbox_curve") == 0)
+        current_state.xbox_curve = atoi_between(value, 25, 400, 100);
+
+    else if (strcasecmp(name, "xbox_trigger_deadzone") == 0)
+        current_state.xbox_trigger_deadzone = atoi_between(value, 0, 30000, 0);
+
+    else if (strcasecmp(name, "xbox_trigger_max") == 0)
+        current_state.xbox_trigger_max = atoi_between(value, 1000, 32767, 32767);
+
+    else if (strcasecmp(name, "gyro_mouse") == 0)
+        current_state.gyro_mouse = atob_default(value, false);
+
+    else if (strcasecmp(name, "gyro_scale") == 0)
+        current_state.gyro_scale = atoi_between(value, 1, 32768, 800);
+
+    else if (strcasecmp(name, "gyro_smoothing") == 0)
+        current_state.gyro_smoothing = atoi_between(value, 0, 500, 10);
+
+    else if (strcasecmp(name, "gyro_calibrate_time") == 0)
+        current_state.gyro_calibrate_time = atoi_between(value, 0, 10000, 1000);
+
+    else if (strcasecmp(name, "gyro_record") == 0)
+        strncpy(gyro_record_file, value, GYRO_FILE_MAX-1);
+
+    else if (strcasecmp(name, "gyro_replay") == 0)
+        strncpy(gyro_replay_file, value, GYRO_FILE_MAX-1);
+
+    else if (strcasecmp(name, "touchpad_mouse") == 0)
+        current_state.touchpad_mouse = atob_default(value, false);
+
+    else if (strcasecmp(name, "touchpad_scale") == 0)
+        current_state.touchpad_scale = atoi_between(value, 1, 32768, 1000);
+
+    else if (strcasecmp(name, "touchpad_accel") == 0)
+        current_state.touchpad_accel = atoi_between(value, 0, 1000, 50);
+
+    else if (strcasecmp(name, "touchpad_scroll_scale") == 0)
+        current_state.touchpad_scroll_scale = atoi_between(value, -1000, 1000, 10);
+
+    else if (strcasecmp(name, "deadzone_calibrate") == 0)
+        current_state.deadzone_calibrate = atob_default(value, false);
+
+    else if (strcasecmp(name, "deadzone_calibrate_time") == 0)
+        current_state.deadzone_calibrate_time = atoi_between(value, 100, 5000, 500);
+
     else if (strcasecmp(name, "dpad_mouse_normalize") == 0)
         current_state.dpad_mouse_normalize = atob_default(value, true);
 
+    else if (strcasecmp(name, "flick_turn") == 0)
+        current_state.flick_turn = atoi_between(value, 100, 100000, 3600);
+
+    else if (strcasecmp(name, "flick_time") == 0)
+        current_state.flick_time = atoi_between(value, 0, 1000, 100);
+
+    else if (strcasecmp(name, "flick_threshold") == 0)
+        current_state.flick_threshold = atoi_between(value, 1000, 32000, 29000);
+
+    else if (strcasecmp(name, "flick_tick") == 0)
+        current_state.flick_tick = atoi_between(value, 1, 16, 2);
+
+    else if (strcasecmp(name, "scroll_speed") == 0)
+        current_state.scroll_speed = atoi_between(value, 1, 100, 10);
+
+    else if (strcasecmp(name, "absolute_width") == 0)
+        current_state.absolute_width = atoi_between(value, 2, 8192, 1280);
+
+    else if (strcasecmp(name, "absolute_height") == 0)
+        current_state.absolute_height = atoi_between(value, 2, 8192, 720);
+
+    else if (strcasecmp(name, "absolute_smoothing") == 0)
+        current_state.absolute_smoothing = atoi_between(value, 0, 1000, 0);
+
+    else if (strcasecmp(name, "pwm_period") == 0)
+        current_state.pwm_period = atoi_between(value, 10, 1000, 50);
+
+    else if (strcasecmp(name, "debounce_time") == 0)
+        current_state.debounce_time = atoi_between(value, 0, 200, 0);
+
+    else if (strcasecmp(name, "left_analog_mouse_scale") == 0)
+        current_state.left_analog_mouse_scale = atoi_between(value, 1, 1000, 100);
+
+    else if (strcasecmp(name, "right_analog_mouse_scale") == 0)
+        current_state.right_analog_mouse_scale = atoi_between(value, 1, 1000, 100);
+
+    else if (strcasecmp(name, "mouse_accel") == 0)
+        current_state.mouse_accel = mouse_accel_get_mode(value);
+
+    else if (strcasecmp(name, "mouse_accel_delay") == 0)
+        current_state.mouse_accel_delay = atoi_between(value, 0, 5000, 250);
+
+    else if (strcasecmp(name, "mouse_accel_time") == 0)
+        current_state.mouse_accel_time = atoi_between(value, 1, 10000, 500);
+
+    else if (strcasecmp(name, "mouse_accel_max") == 0)
+        current_state.mouse_accel_max = atoi_between(value, 100, 2000, 300);
+
+    else if (strcasecmp(name, "dpad_mouse_accel") == 0)
+        current_state.dpad_mouse_accel = mouse_accel_get_mode(value);
+
+    else if (strcasecmp(name, "dpad_mouse_accel_delay") == 0)
+        current_state.dpad_mouse_accel_delay = atoi_between(value, 0, 5000, 250);
+
+    else if (strcasecmp(name, "dpad_mouse_accel_time") == 0)
+        current_state.dpad_mouse_accel_time = atoi_between(value, 1, 10000, 500);
+
+    else if (strcasecmp(name, "dpad_mouse_accel_max") == 0)
+        current_state.dpad_mouse_accel_max = atoi_between(value, 100, 2000, 300);
+
+    else if (strcasecmp(name, "analog_directions") == 0)
+        current_state.analog_directions = analog_get_directions(value);
+
+    else if (strcasecmp(name, "analog_hysteresis") == 0)
+        current_state.analog_hysteresis = atoi_between(value, 0, 32768, 300);
+
+    else if (strcasecmp(name, "analog_angle_hysteresis") == 0)
+        current_state.analog_angle_hysteresis = atoi_between(value, 0, 20, 4);
+
     else if (strcasecmp(name, "mouse_delay") == 0)
-        ((void)0);
+        current_state.mouse_delay = atoi_between(value, 1, 100, MOUSE_REFERENCE_DELAY);
 
     else if (strcasecmp(name, "deadzone_delay") == 0)
         ((void)0);
@@ -571,6 +831,147 @@ static inline void set_btn_as_mouse(int btn, gptokeyb_config *config, int mode)
 }
 
 
+static bool is_zone_word(const char *value, const char *c)
+{   // "zone" on its own, not the start or end of some other word.
+    if (c != value && c[-1] != ' ' && c[-1] != '\t' && c[-1] != ';')
+        return false;
+
+    return (strncasecmp(c, "zone", 4) == 0 && (c[4] == ' ' || c[4] == '\t' || c[4] == '\0'));
+}
+
+
+static const char *find_zone_split(const char *value, const char *start)
+{   /* the next zone keyword or ; that isn't in quotes, from start onwards.
+     *
+     * inih drops everything after " ;" as a comment, so the zone keyword is
+     * what separates zones. A ; straight after the key still works.
+     */
+    char quote = '\0';
+
+    for (const char *c = start; *c != '\0'; c++)
+    {
+        if (quote != '\0')
+        {
+            if (*c == quote)
+                quote = '\0';
+        }
+        else if (*c == '"' || *c == '\'')
+            quote = *c;
+
+        else if (*c == ';' || is_zone_word(value, c))
+            return c;
+    }
+
+    return NULL;
+}
+
+
+static void set_btn_zone(gptokeyb_config *config, int btn, const char *value)
+{   // parses "zone 0.8 = w shift" and adds it to the direction's zone table.
+    char *temp_buffer = tabulate_text(value);
+
+    if (temp_buffer == NULL)
+        return;
+
+    token_ctx *token_state = tokens_create(temp_buffer, '\t');
+    free(temp_buffer);
+
+    gptokeyb_zone zone;
+    const char *token = tokens_next(token_state);
+
+    memset(&zone, 0, sizeof(zone));
+
+    if (token == NULL || strcasecmp(token, "zone") != 0)
+    {
+        fprintf(stderr, "error: %s: expected zone\n", gbtn_names[btn]);
+        tokens_free(token_state);
+        return;
+    }
+
+    token = tokens_next(token_state);
+    if (token == NULL)
+    {
+        fprintf(stderr, "error: %s: zone needs an amount\n", gbtn_names[btn]);
+        tokens_free(token_state);
+        return;
+    }
+
+    float amount = atof(token);
+
+    if (amount <= 0.0f || amount > 1.0f)
+    {
+        fprintf(stderr, "error: %s: zone amount %s needs to be between 0 and 1\n", gbtn_names[btn], token);
+        tokens_free(token_state);
+        return;
+    }
+
+    zone.threshold = (short)(amount * 32767.0f);
+
+    token = tokens_next(token_state);
+    while (token != NULL)
+    {
+        if (strlen(token) == 0 || strcmp(token, "=") == 0)
+        {
+            token = tokens_next(token_state);
+            continue;
+        }
+
+        const keyboard_values *key = find_keyboard(token);
+
+        if (key == NULL)
+        {
+            fprintf(stderr, "error: %s: unknown key %s in zone\n", gbtn_names[btn], token);
+            tokens_free(token_state);
+            return;
+        }
+
+        if (zone.key_count >= ZONE_KEYS_MAX)
+        {
+            fprintf(stderr, "error: %s: too many keys in zone, max is %d\n", gbtn_names[btn], ZONE_KEYS_MAX);
+            tokens_free(token_state);
+            return;
+        }
+
+        zone.keycodes[zone.key_count++] = key->keycode;
+        token = tokens_next(token_state);
+    }
+
+    tokens_free(token_state);
+
+    int min_btn = btn;
+    int max_btn = btn+1;
+
+    if (btn >= GBTN_MAX)
+    {
+        min_btn = special_button_min(btn);
+        max_btn = special_button_max(btn);
+    }
+
+    for (int sbtn=min_btn; sbtn < max_btn; sbtn++)
+    {
+        gptokeyb_button *button = &config->button[sbtn];
+
+        if (button->zone_count >= ZONE_MAX)
+        {
+            fprintf(stderr, "error: %s: too many zones, max is %d\n", gbtn_names[sbtn], ZONE_MAX);
+            return;
+        }
+
+        // keep the table sorted so the lookup can just walk it.
+        int insert = button->zone_count;
+
+        while (insert > 0 && button->zones[insert-1].threshold > zone.threshold)
+        {
+            button->zones[insert] = button->zones[insert-1];
+            insert--;
+        }
+
+        button->zones[insert] = zone;
+        button->zone_count++;
+    }
+}
+
+
 void set_btn_config(gptokeyb_config *config, int btn, const char *name, const char *value)
 {   // this parses a keybinding
     /*
@@ -580,6 +981,62 @@ void set_btn_config(gptokeyb_config *config, int btn, const char *name, const ch
      *   a = add_alt
      */
 
+    const char *zone_split = find_zone_split(value, value);
+
+    if (zone_split != NULL)
+    {   // left_analog_up = w zone 0.8 = w shift zone ...
+        if (!(btn == GBTN_LEFT_ANALOG || btn == GBTN_RIGHT_ANALOG || GBTN_IS_LEFT_ANALOG(btn) || GBTN_IS_RIGHT_ANALOG(btn)))
+        {
+            fprintf(stderr, "error: unable to set zone to %s\n", gbtn_names[btn]);
+            return;
+        }
+
+        char *base_value = strndup(value, (size_t)(zone_split - value));
+
+        set_btn_config(config, btn, name, base_value);
+        free(base_value);
+
+        while (zone_split != NULL)
+        {
+            const char *zone_value = zone_split;
+            char *zone_text;
+
+            if (*zone_value == ';')
+                zone_value++;
+
+            // skip this zone's own keyword, then look for the next one.
+            const char *zone_rest = zone_value;
+
+            while (*zone_rest == ' ' || *zone_rest == '\t')
+                zone_rest++;
+
+            if (is_zone_word(value, zone_rest))
+                zone_rest += 4;
+
+            zone_split = find_zone_split(value, zone_rest);
+
+            if (zone_split != NULL)
+                zone_text = strndup(zone_value, (size_t)(zone_split - zone_value));
+            else
+                zone_text = strdup(zone_value);
+
+            set_btn_zone(config, btn, zone_text);
+            free(zone_text);
+        }
+
+        return;
+    }
+
+    if (btn >= GBTN_MAX)
+    {
+        for (int sbtn=special_button_min(btn); sbtn < special_button_max(btn); sbtn++)
+            config->button[sbtn].zone_count = 0;
+    }
+    else
+    {
+        config->button[btn].zone_count = 0;
+    }
+
     char *temp_buffer = tabulate_text(value);
 
     if (temp_buffer == NULL)
@@ -611,6 +1068,72 @@ void set_btn_config(gptokeyb_config *config, int btn, const char *name, const ch
             set_btn_as_mouse(btn, config, MOUSE_MOVEMENT_OFF);
             config->button[btn].action = ACT_MOUSE_SLOW;
         }
+        else if (strcasecmp(token, "radial_menu") == 0)
+        {   // radial_menu right_analog 1 2 3 4
+            if (btn >= GBTN_MAX)
+            {
+                fprintf(stderr, "error: unable to set %s to %s\n", token, gbtn_names[btn]);
+                tokens_free(token_state);
+                return;
+            }
+
+            token = tokens_next(token_state);
+            if (token == NULL || (strcasecmp(token, "left_analog") != 0 && strcasecmp(token, "right_analog") != 0))
+            {
+                fprintf(stderr, "error: %s: radial_menu needs left_analog or right_analog\n", gbtn_names[btn]);
+                tokens_free(token_state);
+                return;
+            }
+
+            gptokeyb_button *button = &config->button[btn];
+
+            button->radial_stick = ((strcasecmp(token, "left_analog") == 0) ? 0 : 1);
+            button->radial_count = 0;
+
+            token = tokens_next(token_state);
+            while (token != NULL)
+            {
+                if (strlen(token) == 0)
+                {
+                    token = tokens_next(token_state);
+                    continue;
+                }
+
+                const keyboard_values *key = find_keyboard(token);
+
+                if (key == NULL)
+                {
+                    fprintf(stderr, "error: %s: unknown key %s in radial_menu\n", gbtn_names[btn], token);
+                    tokens_free(token_state);
+                    return;
+                }
+
+                if (button->radial_count >= RADIAL_MAX)
+                {
+                    fprintf(stderr, "error: %s: too many keys in radial_menu, max is %d\n", gbtn_names[btn], RADIAL_MAX);
+                    tokens_free(token_state);
+                    return;
+                }
+
+                button->radial_keys[button->radial_count++] = key->keycode;
+                token = tokens_next(token_state);
+            }
+
+            if (button->radial_count < 2)
+            {
+                fprintf(stderr, "error: %s: radial_menu needs at least 2 keys\n", gbtn_names[btn]);
+                tokens_free(token_state);
+                return;
+            }
+
+            set_btn_as_mouse(btn, config, MOUSE_MOVEMENT_OFF);
+            button->keycode = 0;
+            button->action = ACT_RADIAL_MENU;
+
+            // the keys used up the rest of the line.
+            tokens_free(token_state);
+            return;
+        }
         else if (strcasecmp(token, "hold_state") == 0)
         {
             if (btn >= GBTN_MAX)
@@ -735,6 +1258,26 @@ void set_btn_config(gptokeyb_config *config, int btn, const char *name, const ch
                 config->button[btn].repeat = true;
             }
         }
+        else if (strcasecmp(token, "pwm") == 0)
+        {
+            if (btn == GBTN_LEFT_ANALOG || btn == GBTN_RIGHT_ANALOG)
+            {
+                for (int sbtn=special_button_min(btn); sbtn < special_button_max(btn); sbtn++)
+                {
+                    config->button[sbtn].pwm = true;
+                }
+            }
+            else if (GBTN_IS_LEFT_ANALOG(btn) || GBTN_IS_RIGHT_ANALOG(btn))
+            {
+                config->button[btn].pwm = true;
+            }
+            else
+            {
+                fprintf(stderr, "error: unable to set %s to %s\n", token, gbtn_names[btn]);
+                tokens_free(token_state);
+                return;
+            }
+        }
         else if (strcasecmp(token, "parent") == 0)
         {
             set_btn_as_mouse(btn, config, MOUSE_MOVEMENT_PARENT);
@@ -816,6 +1359,55 @@ void set_btn_config(gptokeyb_config *config, int btn, const char *name, const ch
                     return;
                 }
             }
+            else if (strcasecmp(token, "scroll") == 0)
+            {
+                if (btn >= GBTN_MAX)
+                {
+                    set_btn_as_mouse(btn, config, MOUSE_MOVEMENT_SCROLL);
+
+                    for (int sbtn=special_button_min(btn); sbtn < special_button_max(btn); sbtn++)
+                    {
+                        config->button[sbtn].keycode = 0;
+                        config->button[sbtn].action = ACT_NONE;
+                    }
+                }
+                else
+                {
+                    fprintf(stderr, "error: unable to set %s to %s\n", token, gbtn_names[btn]);
+                    tokens_free(token_state);
+                    return;
+                }
+            }
+            else if (strcasecmp(token, "flick_stick") == 0 || strcasecmp(token, "absolute_mouse") == 0)
+            {
+                if (btn == GBTN_LEFT_ANALOG || btn == GBTN_RIGHT_ANALOG)
+                {
+                    int other_mode = ((btn == GBTN_LEFT_ANALOG) ? config->right_analog_as_mouse : config->left_analog_as_mouse);
+
+                    // there is only the one pointer, both sticks would fight over it.
+                    if (strcasecmp(token, "absolute_mouse") == 0 && other_mode == MOUSE_MOVEMENT_ABSOLUTE)
+                    {
+                        fprintf(stderr, "error: unable to set %s to %s, the other stick is already the absolute_mouse\n", token, gbtn_names[btn]);
+                        tokens_free(token_state);
+                        return;
+                    }
+
+                    set_btn_as_mouse(btn, config,
+                        ((strcasecmp(token, "flick_stick") == 0) ? MOUSE_MOVEMENT_FLICK : MOUSE_MOVEMENT_ABSOLUTE));
+
+                    for (int sbtn=special_button_min(btn); sbtn < special_button_max(btn); sbtn++)
+                    {
+                        config->button[sbtn].keycode = 0;
+                        config->button[sbtn].action = ACT_NONE;
+                    }
+                }
+                else
+                {
+                    fprintf(stderr, "error: unable to set %s to %s\n", token, gbtn_names[btn]);
+                    tokens_free(token_state);
+                    return;
+                }
+            }
             else if (strcasecmp(token, "arrow_keys") == 0)
             {
                 if (btn >= GBTN_MAX)
@@ -871,6 +1463,11 @@ static int config_ini_handler(
 
             gptk_hk_can_fix = false;
         }
+        else if (strcasecmp(section, "xbox") == 0)
+        {
+            // GPTK2_DEBUG("XBOX\n");
+            config->state = CFG_XBOX;
+        }
         else if (strcasestartswith(section, "controls:"))
         {
             // GPTK2_DEBUG("CONTROLS++\n");
@@ -997,6 +1594,10 @@ static int config_ini_handler(
             function_config_configure(config->current_config, name, value);
         }
     }
+    else if (config->state == CFG_XBOX)
+    {   // xbox360 routing.
+        xbox_config(name, value);
+    }
     else
     {
         GPTK2_DEBUG("?: %s: %s\n", name, value);
@@ -0,0 +1,167 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Button debouncing.
+ *
+ * Worn switches can flicker on and off for a few ms when pressed or let go.
+ * The first edge goes through straight away, then the button is locked for
+ * debounce_time ms. Edges in that window are counted as bounces and not
+ * passed on. When the window ends the button is set to wherever the switch
+ * ended up, so a real release inside the window is only late, never lost.
+ *
+ * Nothing sleeps here, state_next_deadline() tells the main loop when the
+ * next window ends.
+ */
+
+static Uint64 debounce_time_us = 0;
+static Uint32 debounce_pending = 0;
+static Uint32 debounce_raw = 0;
+static Uint64 debounce_until_us[GBTN_MAX];
+static Uint32 debounce_suppressed[GBTN_MAX];
+
+
+void debounce_finalise()
+{   // call after the config is loaded
+    debounce_time_us = (Uint64)(current_state.debounce_time) * 1000;
+    debounce_pending = 0;
+    debounce_raw = 0;
+
+    memset(debounce_until_us, 0, sizeof(debounce_until_us));
+    memset(debounce_suppressed, 0, sizeof(debounce_suppressed));
+}
+
+
+void debounce_button(int btn, bool pressed)
+{   // front end for buttons that come from a switch.
+    Uint32 btn_mask = (1<<btn);
+
+    if (debounce_time_us == 0)
+    {
+        update_button(btn, pressed);
+        return;
+    }
+
+    if (pressed)
+        debounce_raw |=  btn_mask;
+    else
+        debounce_raw &= ~btn_mask;
+
+    Uint64 now_us = timer_now_us();
+
+    if (now_us < debounce_until_us[btn])
+    {   // still settling, sort it out when the window ends.
+        debounce_suppressed[btn]++;
+        debounce_pending |= btn_mask;
+
+        GPTK2_DEBUG("BOUNCE '%s' (%u)\n", gbtn_names[btn], debounce_suppressed[btn]);
+        return;
+    }
+
+    debounce_until_us[btn] = now_us + debounce_time_us;
+    debounce_pending &= ~btn_mask;
+
+    update_button(btn, pressed);
+}
+
+
+void debounce_update()
+{   // called from state_update(), settles any buttons whose window has ended.
+    if (debounce_pending == 0)
+        return;
+
+    Uint64 now_us = timer_now_us();
+
+    for (int btn=0; btn < GBTN_MAX; btn++)
+    {
+        Uint32 btn_mask = (1<<btn);
+
+        if ((debounce_pending & btn_mask) == 0)
+            continue;
+
+        if (now_us < debounce_until_us[btn])
+            continue;
+
+        debounce_pending &= ~btn_mask;
+
+        bool pressed = ((debounce_raw & btn_mask) != 0);
+
+        if (pressed == is_pressed(btn))
+            continue;
+
+        // the switch really did change, this starts a new window.
+        debounce_until_us[btn] = now_us + debounce_time_us;
+        update_button(btn, pressed);
+    }
+}
+
+
+Uint64 debounce_next_deadline()
+{   // when the next window ends, 0 if nothing is waiting.
+    Uint64 deadline_us = 0;
+
+    if (debounce_pending == 0)
+        return 0;
+
+    for (int btn=0; btn < GBTN_MAX; btn++)
+    {
+        if ((debounce_pending & (1<<btn)) == 0)
+            continue;
+
+        if (deadline_us == 0 || debounce_until_us[btn] < deadline_us)
+            deadline_us = debounce_until_us[btn];
+    }
+
+    return deadline_us;
+}
+
+
+void debounce_report()
+{   // how many bounces each button had, handy for finding worn switches.
+    if (debounce_time_us == 0)
+        return;
+
+    for (int btn=0; btn < GBTN_MAX; btn++)
+    {
+        if (debounce_suppressed[btn] == 0)
+            continue;
+
+        printf("debounce: %s suppressed %u bounces\n", gbtn_names[btn], debounce_suppressed[btn]);
+    }
+}
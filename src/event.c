@@ -48,6 +48,12 @@ void handleInputEvent(const SDL_Event *event)
         {
             const bool pressed = event->type == SDL_CONTROLLERBUTTONDOWN;
 
+            if (hybrid_mode)
+            {
+                hybrid_button_event(event, pressed);
+                break;
+            }
+
             if (xbox360_mode)
             {
                 handleEventBtnFakeXbox360Device(event, pressed);
@@ -58,7 +64,11 @@ void handleInputEvent(const SDL_Event *event)
         break;
 
     case SDL_CONTROLLERAXISMOTION:
-        if (xbox360_mode)
+        if (hybrid_mode)
+        {
+            hybrid_axis_event(event);
+        }
+        else if (xbox360_mode)
         {
             handleEventAxisFakeXbox360Device(event);
         }
@@ -68,6 +78,18 @@ void handleInputEvent(const SDL_Event *event)
         }
         break;
 
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    case SDL_CONTROLLERSENSORUPDATE:
+        gyro_sensor_event(event);
+        break;
+
+    case SDL_CONTROLLERTOUCHPADDOWN:
+    case SDL_CONTROLLERTOUCHPADMOTION:
+    case SDL_CONTROLLERTOUCHPADUP:
+        touchpad_event(event);
+        break;
+#endif
+
     case SDL_CONTROLLERDEVICEADDED:
         {
             SDL_GameController* controller = SDL_GameControllerOpen(event->cdevice.which);
@@ -78,6 +100,9 @@ void handleInputEvent(const SDL_Event *event)
                 if (strcmp(name, XBOX_CONTROLLER_NAME) != 0)
                 {
                     SDL_GameControllerOpen(event->cdevice.which);
+                    calibrate_controller(controller);
+                    gyro_controller_added(controller);
+                    rumble_controller_added(controller);
                 }
             }
         }
@@ -88,6 +113,9 @@ void handleInputEvent(const SDL_Event *event)
             SDL_GameController* controller = SDL_GameControllerFromInstanceID(event->cdevice.which);
             if (controller)
             {
+                calibrate_controller_removed(controller);
+                gyro_controller_removed(controller);
+                rumble_controller_removed(controller);
                 SDL_GameControllerClose(controller);
             }
         }
@@ -96,5 +124,9 @@ void handleInputEvent(const SDL_Event *event)
     case SDL_QUIT:
         current_state.running = false;
         return;
+
+    default:
+        rumble_event(event);
+        break;
     }
 }
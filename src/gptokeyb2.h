@@ -78,6 +78,9 @@
 // It's a lie, but it is not cake
 #define XBOX_CONTROLLER_NAME "Microsoft X-Box 360 pad"
 
+// rumble effects the fake pad can hold at once.
+#define XBOX_FF_EFFECTS 16
+
 // surely this is enough. :TurtleThink: 
 #define MAX_CONTROL_NAME 64
 
@@ -86,11 +89,40 @@
 
 #define FN_ID_MAX 16
 
+#define GYRO_FILE_MAX 1024
+
+// events per output frame, and the output engines.
+#define OUTPUT_FRAME_MAX 64
+
+#define OUTPUT_ENGINE_WRITE    0
+#define OUTPUT_ENGINE_IO_URING 1
+
+#define OUTPUT_SINK_UINPUT 0
+#define OUTPUT_SINK_NULL   1
+#define OUTPUT_SINK_MEMORY 2
+#define OUTPUT_SINK_FILE   3
+
+#define OUTPUT_FILE_MAX 1024
+
+#define OUTPUT_DEVICE_MAIN    0
+#define OUTPUT_DEVICE_PAD     1
+#define OUTPUT_DEVICE_POINTER 2
+#define OUTPUT_DEVICE_MAX     3
+
 // keyboard mods
 #define MOD_SHIFT 0x01
 #define MOD_CTRL  0x02
 #define MOD_ALT   0x04
 
+// deadzone_scale and dpad_mouse_step are in pixels per this many ms.
+#define MOUSE_REFERENCE_DELAY 16
+
+// REL_WHEEL_HI_RES units per wheel click
+#define MOUSE_WHEEL_DETENT 120
+
+// pwm_duty is 0 - PWM_DUTY_MAX
+#define PWM_DUTY_MAX 1000
+
 
 // Deadzone modes
 enum
@@ -105,6 +137,38 @@ enum
 };
 
 
+// Mouse acceleration profiles
+enum
+{
+    MOUSE_ACCEL_CONSTANT,
+    MOUSE_ACCEL_RAMP,
+    MOUSE_ACCEL_SQUARED,
+};
+
+
+// Analog stick to direction modes
+enum
+{
+    ANALOG_DIR_AXIAL,
+    ANALOG_DIR_4WAY,
+    ANALOG_DIR_8WAY,
+};
+
+// Direction bits, in the same order as GBTN_*_ANALOG_UP/DOWN/LEFT/RIGHT
+#define ANALOG_MASK_UP    0x01
+#define ANALOG_MASK_DOWN  0x02
+#define ANALOG_MASK_LEFT  0x04
+#define ANALOG_MASK_RIGHT 0x08
+
+// Trigger stages
+#define TRIGGER_MASK_HALF 0x01
+#define TRIGGER_MASK_FULL 0x02
+
+// Binary angle, 65536 units is a full turn.
+#define ANALOG_ANGLE_FULL    65536
+#define ANALOG_ANGLE_DEGREES(deg) ((int)(((deg) * ANALOG_ANGLE_FULL) / 360))
+
+
 // BUTTON DEFS
 enum
 {
@@ -141,6 +205,9 @@ enum
     GBTN_RIGHT_ANALOG_LEFT,
     GBTN_RIGHT_ANALOG_RIGHT,
 
+    GBTN_L2_FULL,
+    GBTN_R2_FULL,
+
     GBTN_MAX,
 
     // SPECIAL
@@ -173,6 +240,7 @@ enum
     ACT_PARENT,
     ACT_MOUSE_SLOW,
     ACT_STATE_POP,
+    ACT_RADIAL_MENU,
     // Make sure these are last, that way we can check for
     // (action >= ACT_STATE_HOLD) to see if it needs a cfg_name
     ACT_STATE_HOLD,
@@ -189,14 +257,39 @@ typedef struct _token_ctx token_ctx;
 #define MOUSE_MOVEMENT_PARENT -1
 #define MOUSE_MOVEMENT_OFF 0
 #define MOUSE_MOVEMENT_ON 1
+#define MOUSE_MOVEMENT_FLICK 2
+#define MOUSE_MOVEMENT_SCROLL 3
+#define MOUSE_MOVEMENT_ABSOLUTE 4
 
 typedef struct _gptokeyb_config gptokeyb_config;
 
+// extra keys for stick directions pushed further, see set_btn_zones().
+#define ZONE_MAX 3
+#define ZONE_KEYS_MAX 4
+
+// keys in a radial_menu
+#define RADIAL_MAX 8
+
+typedef struct
+{
+    short threshold;
+    short key_count;
+    short keycodes[ZONE_KEYS_MAX];
+} gptokeyb_zone;
+
 typedef struct
 {
     short keycode;
     short modifier;
     bool repeat;
+    bool pwm;
+
+    int zone_count;
+    gptokeyb_zone zones[ZONE_MAX];
+
+    short radial_stick;
+    short radial_count;
+    short radial_keys[RADIAL_MAX];
     int action;
 
     int fn_id;
@@ -212,7 +305,7 @@ struct _gptokeyb_config
     gptokeyb_config *next;
     const char *name;
 
-    // one of MOUSE_MOVEMENT_PARENT / OFF / ON
+    // one of MOUSE_MOVEMENT_PARENT / OFF / ON / FLICK / SCROLL / ABSOLUTE
     int left_analog_as_mouse;
     int right_analog_as_mouse;
     int dpad_as_mouse;
@@ -239,8 +332,27 @@ typedef struct
     Uint32 held_since[GBTN_MAX];
     Uint32 next_repeat[GBTN_MAX];
 
+    Uint32 in_pwm;
+    Uint32 pwm_output;
+    int pwm_duty[GBTN_MAX];
+    Uint64 pwm_cycle_us[GBTN_MAX];
+    Uint64 pwm_next_us[GBTN_MAX];
+
+    Uint8 zone_level[GBTN_MAX];
+
+    // only set while a radial_menu button is held
+    const gptokeyb_button *radial_menu;
+    int radial_menu_btn;
+    int radial_selected;
+
     int fnc_ids[FN_ID_MAX];
 
+    int raw_left_analog_x;
+    int raw_left_analog_y;
+
+    int raw_right_analog_x;
+    int raw_right_analog_y;
+
     int current_left_analog_x;
     int current_left_analog_y;
 
@@ -250,25 +362,91 @@ typedef struct
     int current_l2;
     int current_r2;
 
-    int mouse_x;
-    int mouse_y;
+    // one per stick, [0] is the left stick
+    float analog_mouse_x[2];
+    float analog_mouse_y[2];
+    int left_analog_mouse_scale;
+    int right_analog_mouse_scale;
 
+    int mouse_delay;
     int dpad_mouse_step;
     int mouse_slow_scale;
     bool dpad_mouse_normalize;
 
+    int flick_turn;
+    int flick_time;
+    int flick_threshold;
+    int flick_tick;
+
+    float scroll_x[2];
+    float scroll_y[2];
+    int scroll_speed;
+
+    int absolute_width;
+    int absolute_height;
+    int absolute_smoothing;
+
+    int pwm_period;
+
+    int debounce_time;
+
+    int mouse_accel;
+    int mouse_accel_delay;
+    int mouse_accel_time;
+    int mouse_accel_max;
+
+    int dpad_mouse_accel;
+    int dpad_mouse_accel_delay;
+    int dpad_mouse_accel_time;
+    int dpad_mouse_accel_max;
+
     int deadzone_mode;
     int deadzone_scale;
 
     int deadzone_x;
     int deadzone_y;
     int deadzone_triggers;
+    int trigger_full;
+    int trigger_hysteresis;
+
+    // xbox360 / hybrid pad output
+    int xbox_left_deadzone;
+    int xbox_right_deadzone;
+    int xbox_anti_deadzone;
+    int xbox_curve;
+    int xbox_trigger_deadzone;
+    int xbox_trigger_max;
+
+    bool gyro_mouse;
+    int gyro_scale;
+    int gyro_smoothing;
+    int gyro_calibrate_time;
+
+    bool touchpad_mouse;
+    int touchpad_scale;
+    int touchpad_accel;
+    int touchpad_scroll_scale;
+
+    bool deadzone_calibrate;
+    int deadzone_calibrate_time;
+
+    int analog_directions;
+    int analog_hysteresis;
+    int analog_angle_hysteresis;
+
+    int left_analog_sector;
+    int right_analog_sector;
 
     int hotkey_gbtn;
     bool running;
 
     Uint64 repeat_delay;
     Uint64 repeat_rate;
+    bool kernel_repeat;
+
+    int output_sink;
+    int output_engine;
+    bool output_benchmark;
 } gptokeyb_state;
 
 
@@ -341,10 +519,17 @@ extern int gptokeyb_config_depth;
 extern bool current_dpad_as_mouse;
 extern bool current_left_analog_as_mouse;
 extern bool current_right_analog_as_mouse;
+extern int current_dpad_mode;
+extern int current_left_analog_mode;
+extern int current_right_analog_mode;
+extern bool current_left_analog_pwm;
+extern bool current_right_analog_pwm;
 
 // stuff
 extern int uinp_fd;
 extern bool xbox360_mode;
+extern bool hybrid_mode;
+extern int xbox_fd;
 extern bool config_mode;
 
 extern bool want_pc_quit;
@@ -354,6 +539,11 @@ extern char kill_process_name[];
 
 extern char game_prefix[];
 
+extern char gyro_record_file[];
+extern char gyro_replay_file[];
+
+extern char output_file[];
+
 // config.c
 void config_init();
 void config_quit();
@@ -376,8 +566,90 @@ float vector2d_magnitude(const vector2d *vec2d);
 
 int deadzone_get_mode(const char *str);
 const char *deadzone_mode_str(int mode);
-void deadzone_trigger_calc(int *analog, int analog_in);
-void deadzone_mouse_calc(int *x, int *y, int in_x, int in_y);
+int deadzone_trigger_calc(int analog_in, int last_mask);
+void deadzone_mouse_calc(float *x, float *y, int in_x, int in_y);
+
+void analog_init();
+void analog_finalise();
+int analog_get_directions(const char *str);
+const char *analog_directions_str(int mode);
+Uint16 analog_angle(int x, int y);
+int analog_direction_mask(int *sector, int x, int y, int last_mask);
+int analog_radial_sector(int x, int y, int count);
+
+// mouse.c
+int mouse_accel_get_mode(const char *str);
+const char *mouse_accel_mode_str(int mode);
+void mouse_finalise();
+void mouse_reset();
+void mouse_update();
+void flick_stick_update(int stick_id, int x, int y);
+void flick_stick_reset(int stick_id);
+bool flick_active();
+
+// pointer.c
+void pointer_init();
+void pointer_quit();
+void pointer_stick_update(int x, int y);
+bool pointer_active();
+void pointer_update(float dt);
+
+// debounce.c
+void debounce_finalise();
+void debounce_button(int btn, bool pressed);
+void debounce_update();
+Uint64 debounce_next_deadline();
+void debounce_report();
+
+// output.c
+int output_get_engine(const char *str);
+const char *output_engine_str(int engine);
+int output_get_sink(const char *str);
+const char *output_sink_str(int sink);
+const char *output_device_str(int device);
+void output_device(int device, int fd);
+void output_init(int fd);
+void output_quit();
+void output_write_device(int device, const struct input_event *events, int count);
+void output_write(const struct input_event *events, int count);
+void output_submit();
+void output_benchmark();
+
+// rumble.c
+void setupFakeXbox360Rumble(struct uinput_user_dev *device, int fd);
+void rumble_init(int fd);
+void rumble_quit();
+void rumble_controller_added(SDL_GameController *controller);
+void rumble_controller_removed(SDL_GameController *controller);
+bool rumble_event(const SDL_Event *event);
+
+// timer.c
+Uint64 timer_now_us();
+void timer_sleep_until(Uint64 deadline_us);
+
+// calibrate.c
+void calibrate_controller(SDL_GameController *controller);
+void calibrate_controller_removed(SDL_GameController *controller);
+void calibrate_update();
+Uint64 calibrate_next_deadline();
+void calibrate_stick(int stick_id, int *x, int *y);
+void calibrate_quit();
+
+// gyro.c
+void gyro_init();
+void gyro_quit();
+void gyro_controller_added(SDL_GameController *controller);
+void gyro_controller_removed(SDL_GameController *controller);
+void gyro_sensor_event(const SDL_Event *event);
+bool gyro_active();
+void gyro_update();
+void gyro_take(float *x, float *y);
+
+// touchpad.c
+void touchpad_event(const SDL_Event *event);
+bool touchpad_active();
+void touchpad_take(float *x, float *y, float dt);
+void touchpad_take_scroll(float *wheel, float *hwheel);
 
 // keys.c
 const keyboard_values *find_keyboard(const char *key);
@@ -429,7 +701,13 @@ const char *string_register(const char *string);
 
 // from og gptokeyb
 void emit(int type, int code, int val);
+void emit_flush();
+void emit_drain();
+void emit_release_all();
+int uinput_create(int fd, const struct uinput_user_dev *device);
+void emit_report();
 void emitMouseMotion(int x, int y);
+void emitMouseReport(int x, int y, int wheel, int hwheel, int wheel_hi_res, int hwheel_hi_res);
 void emitAxisMotion(int code, int value);
 void emitTextInputKey(int code, bool uppercase);
 void emitKey(int code, bool is_pressed, int modifier);
@@ -445,9 +723,13 @@ bool was_pressed(int btn);
 bool was_released(int btn);
 
 void update_button(int btn, bool pressed);
+const gptokeyb_button *state_button(int btn);
+void update_button_zone(int btn, Sint64 magnitude_sq);
+void radial_menu_update(int x, int y);
 
 void state_init();
 void state_update();
+Uint64 state_next_deadline();
 gptokeyb_config *state_active();
 
 void push_state(gptokeyb_config *);
@@ -460,10 +742,19 @@ void handleInputEvent(const SDL_Event *event);
 
 // keyboard.c
 void setupFakeKeyboardMouseDevice(struct uinput_user_dev *device, int fd);
+void setupFakeKeyboardRepeat();
 void handleEventBtnFakeKeyboardMouseDevice(const SDL_Event *event, bool is_pressed);
 void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event *event);
 
+// hybrid.c
+void hybrid_update_routes();
+void hybrid_button_event(const SDL_Event *event, bool pressed);
+void hybrid_axis_event(const SDL_Event *event);
+
 // xbox360.c
+void xbox_config(const char *name, const char *value);
+void xbox_dump();
+void xbox_finalise();
 void setupFakeXbox360Device(struct uinput_user_dev *device, int fd);
 void handleEventBtnFakeXbox360Device(const SDL_Event *event, bool is_pressed);
 void handleEventAxisFakeXbox360Device(const SDL_Event *event);
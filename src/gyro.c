@@ -0,0 +1,353 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Gyro to mouse.
+ *
+ * Gyro samples come in at 200-1000 Hz, way faster than we update the mouse.
+ * Each sample is integrated into a pixel accumulator straight away, the mouse
+ * tick then takes whatever has built up and sends it as one movement.
+ *
+ * Traces can be recorded with gyro_record and played back with gyro_replay,
+ * so the pipeline can be tested without a device that has a gyro.
+ */
+
+// Below this (rad/s) after bias removal we treat the controller as still.
+#define GYRO_DEADBAND 0.005f
+// Ignore gaps bigger than this (s), after a stall or when the sensor starts.
+#define GYRO_MAX_DT 0.05f
+// Keep the mouse tick going this long (us) after the last movement.
+#define GYRO_IDLE_US 100000
+
+#define GYRO_TRACE_LINE 256
+
+char gyro_record_file[GYRO_FILE_MAX] = "";
+char gyro_replay_file[GYRO_FILE_MAX] = "";
+
+static bool gyro_enabled = false;
+static SDL_GameController *gyro_controller = NULL;
+static Uint64 gyro_moving_until_us = 0;
+
+static Uint64 gyro_last_us = 0;
+
+static bool gyro_calibrating = true;
+static Uint64 gyro_calibrate_end_us = 0;
+static float gyro_bias_total[3] = {0.0f, 0.0f, 0.0f};
+static int gyro_bias_samples = 0;
+static float gyro_bias[3] = {0.0f, 0.0f, 0.0f};
+
+static float gyro_smooth_x = 0.0f;
+static float gyro_smooth_y = 0.0f;
+
+static float gyro_accum_x = 0.0f;
+static float gyro_accum_y = 0.0f;
+
+static FILE *gyro_record_fp = NULL;
+static FILE *gyro_replay_fp = NULL;
+static Uint64 gyro_replay_start_us = 0;
+static Uint64 gyro_replay_first_us = 0;
+static Uint64 gyro_replay_next_us = 0;
+static float gyro_replay_next_data[3];
+
+
+static void gyro_sample(Uint64 timestamp_us, const float *data)
+{
+    if (gyro_record_fp != NULL)
+    {
+        fprintf(gyro_record_fp, "%llu %f %f %f\n",
+            (unsigned long long)(timestamp_us), data[0], data[1], data[2]);
+    }
+
+    if (gyro_last_us == 0 || timestamp_us <= gyro_last_us)
+    {
+        gyro_last_us = timestamp_us;
+        gyro_calibrate_end_us = timestamp_us + ((Uint64)(current_state.gyro_calibrate_time) * 1000);
+        return;
+    }
+
+    float dt = (float)(timestamp_us - gyro_last_us) / 1000000.0f;
+    gyro_last_us = timestamp_us;
+
+    if (dt > GYRO_MAX_DT)
+        dt = GYRO_MAX_DT;
+
+    if (gyro_calibrating)
+    {   // average the resting gyro to find its bias.
+        for (int i=0; i < 3; i++)
+            gyro_bias_total[i] += data[i];
+
+        gyro_bias_samples++;
+
+        if (timestamp_us >= gyro_calibrate_end_us)
+        {
+            for (int i=0; i < 3; i++)
+                gyro_bias[i] = gyro_bias_total[i] / (float)(gyro_bias_samples);
+
+            gyro_calibrating = false;
+
+            GPTK2_DEBUG("gyro: bias %f %f %f from %d samples\n",
+                gyro_bias[0], gyro_bias[1], gyro_bias[2], gyro_bias_samples);
+        }
+        return;
+    }
+
+    // yaw moves the mouse left/right, pitch moves it up/down.
+    float rate_x = -(data[1] - gyro_bias[1]);
+    float rate_y = -(data[0] - gyro_bias[0]);
+
+    if (fabs(rate_x) < GYRO_DEADBAND)
+        rate_x = 0.0f;
+
+    if (fabs(rate_y) < GYRO_DEADBAND)
+        rate_y = 0.0f;
+
+    if (current_state.gyro_smoothing > 0)
+    {
+        float alpha = dt / (dt + ((float)(current_state.gyro_smoothing) / 1000.0f));
+
+        gyro_smooth_x += alpha * (rate_x - gyro_smooth_x);
+        gyro_smooth_y += alpha * (rate_y - gyro_smooth_y);
+
+        // the filter only decays towards zero, snap it once it settles.
+        if (rate_x == 0.0f && fabs(gyro_smooth_x) < GYRO_DEADBAND)
+            gyro_smooth_x = 0.0f;
+
+        if (rate_y == 0.0f && fabs(gyro_smooth_y) < GYRO_DEADBAND)
+            gyro_smooth_y = 0.0f;
+    }
+    else
+    {
+        gyro_smooth_x = rate_x;
+        gyro_smooth_y = rate_y;
+    }
+
+    if (gyro_smooth_x != 0.0f || gyro_smooth_y != 0.0f)
+        gyro_moving_until_us = timer_now_us() + GYRO_IDLE_US;
+
+    gyro_accum_x += gyro_smooth_x * (float)(current_state.gyro_scale) * dt;
+    gyro_accum_y += gyro_smooth_y * (float)(current_state.gyro_scale) * dt;
+}
+
+
+static bool gyro_replay_read()
+{
+    char line[GYRO_TRACE_LINE];
+    unsigned long long timestamp_us;
+
+    while (fgets(line, sizeof(line), gyro_replay_fp) != NULL)
+    {
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "%llu %f %f %f", &timestamp_us,
+                &gyro_replay_next_data[0], &gyro_replay_next_data[1], &gyro_replay_next_data[2]) != 4)
+            continue;
+
+        gyro_replay_next_us = (Uint64)(timestamp_us);
+        return true;
+    }
+
+    printf("gyro: finished replaying '%s'\n", gyro_replay_file);
+
+    fclose(gyro_replay_fp);
+    gyro_replay_fp = NULL;
+    return false;
+}
+
+
+void gyro_init()
+{   // call after the config is loaded
+    if (!current_state.gyro_mouse)
+        return;
+
+    if (strlen(gyro_record_file) > 0)
+    {
+        gyro_record_fp = fopen(gyro_record_file, "w");
+
+        if (gyro_record_fp == NULL)
+            fprintf(stderr, "gyro: unable to record to '%s'\n", gyro_record_file);
+        else
+            fprintf(gyro_record_fp, "# timestamp_us pitch yaw roll (rad/s)\n");
+    }
+
+    if (strlen(gyro_replay_file) > 0)
+    {
+        gyro_replay_fp = fopen(gyro_replay_file, "r");
+
+        if (gyro_replay_fp == NULL)
+        {
+            fprintf(stderr, "gyro: unable to replay '%s'\n", gyro_replay_file);
+        }
+        else if (gyro_replay_read())
+        {
+            printf("gyro: replaying '%s'\n", gyro_replay_file);
+
+            gyro_replay_start_us = timer_now_us();
+            gyro_replay_first_us = gyro_replay_next_us;
+            gyro_enabled = true;
+        }
+    }
+}
+
+
+void gyro_quit()
+{
+    if (gyro_record_fp != NULL)
+    {
+        fclose(gyro_record_fp);
+        gyro_record_fp = NULL;
+    }
+
+    if (gyro_replay_fp != NULL)
+    {
+        fclose(gyro_replay_fp);
+        gyro_replay_fp = NULL;
+    }
+}
+
+
+void gyro_controller_added(SDL_GameController *controller)
+{
+    if (!current_state.gyro_mouse || gyro_replay_fp != NULL)
+        return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    if (!SDL_GameControllerHasSensor(controller, SDL_SENSOR_GYRO))
+    {
+        printf("gyro: controller has no gyro\n");
+        return;
+    }
+
+    if (SDL_GameControllerSetSensorEnabled(controller, SDL_SENSOR_GYRO, SDL_TRUE) != 0)
+    {
+        printf("gyro: unable to enable gyro: %s\n", SDL_GetError());
+        return;
+    }
+
+    printf("gyro: enabled at %.0f Hz, keep the controller still for a moment.\n",
+        SDL_GameControllerGetSensorDataRate(controller, SDL_SENSOR_GYRO));
+
+    gyro_enabled = true;
+    gyro_controller = controller;
+    gyro_calibrating = true;
+    gyro_last_us = 0;
+#else
+    printf("gyro: needs SDL 2.0.14 or newer\n");
+#endif
+}
+
+
+void gyro_controller_removed(SDL_GameController *controller)
+{
+    if (gyro_controller != controller)
+        return;
+
+    gyro_controller = NULL;
+    gyro_moving_until_us = 0;
+
+    if (gyro_replay_fp == NULL)
+    {
+        gyro_enabled = false;
+        gyro_smooth_x = gyro_smooth_y = 0.0f;
+        gyro_accum_x = gyro_accum_y = 0.0f;
+    }
+}
+
+
+void gyro_sensor_event(const SDL_Event *event)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    if (!gyro_enabled || gyro_replay_fp != NULL || event->csensor.sensor != SDL_SENSOR_GYRO)
+        return;
+
+#if SDL_VERSION_ATLEAST(2, 26, 0)
+    Uint64 timestamp_us = event->csensor.timestamp_us;
+
+    if (timestamp_us == 0)
+        timestamp_us = timer_now_us();
+#else
+    Uint64 timestamp_us = timer_now_us();
+#endif
+
+    gyro_sample(timestamp_us, event->csensor.data);
+#endif
+}
+
+
+bool gyro_active()
+{   // only while there is movement to send, so a still controller lets the main loop sleep.
+    if (!gyro_enabled)
+        return false;
+
+    if (gyro_replay_fp != NULL)
+        return true;
+
+    if (gyro_accum_x != 0.0f || gyro_accum_y != 0.0f)
+        return true;
+
+    return (timer_now_us() < gyro_moving_until_us);
+}
+
+
+void gyro_update()
+{   // feed any replay samples that are due.
+    if (gyro_replay_fp == NULL)
+        return;
+
+    Uint64 elapsed_us = timer_now_us() - gyro_replay_start_us;
+
+    while (gyro_replay_fp != NULL && (gyro_replay_next_us - gyro_replay_first_us) <= elapsed_us)
+    {
+        gyro_sample(gyro_replay_next_us, gyro_replay_next_data);
+        gyro_replay_read();
+    }
+
+    if (gyro_replay_fp == NULL)
+        gyro_enabled = false;
+}
+
+
+void gyro_take(float *x, float *y)
+{   // hand the built up movement to the mouse tick.
+    *x += gyro_accum_x;
+    *y += gyro_accum_y;
+
+    gyro_accum_x = 0.0f;
+    gyro_accum_y = 0.0f;
+}
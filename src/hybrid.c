@@ -0,0 +1,197 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Hybrid mode.
+ *
+ * Creates the Xbox 360 pad and the keyboard / mouse together. The keyboard
+ * side sees every event like it always does, buttons that aren't bound to
+ * anything there just don't send anything. Whatever isn't bound is also sent
+ * to the pad.
+ *
+ * Which is which gets worked out whenever the state changes and stored by SDL
+ * button / axis, so handling an event is one lookup. A button keeps the route
+ * it was pressed with until it is let go, so changing state while holding it
+ * can't leave the pad with a button stuck down.
+ */
+
+#define HYBRID_ROUTE_NONE     0
+#define HYBRID_ROUTE_KEYBOARD 1
+#define HYBRID_ROUTE_PAD      2
+
+static Uint8 hybrid_button_route[SDL_CONTROLLER_BUTTON_MAX];
+static Uint8 hybrid_axis_route[SDL_CONTROLLER_AXIS_MAX];
+static bool hybrid_button_latched[SDL_CONTROLLER_BUTTON_MAX];
+
+
+static int hybrid_button_gbtn(int sdl_button)
+{
+    switch (sdl_button)
+    {
+    case SDL_CONTROLLER_BUTTON_A:             return GBTN_A;
+    case SDL_CONTROLLER_BUTTON_B:             return GBTN_B;
+    case SDL_CONTROLLER_BUTTON_X:             return GBTN_X;
+    case SDL_CONTROLLER_BUTTON_Y:             return GBTN_Y;
+    case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:  return GBTN_L1;
+    case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER: return GBTN_R1;
+    case SDL_CONTROLLER_BUTTON_LEFTSTICK:     return GBTN_L3;
+    case SDL_CONTROLLER_BUTTON_RIGHTSTICK:    return GBTN_R3;
+    case SDL_CONTROLLER_BUTTON_GUIDE:         return GBTN_GUIDE;
+    case SDL_CONTROLLER_BUTTON_BACK:          return GBTN_BACK;
+    case SDL_CONTROLLER_BUTTON_START:         return GBTN_START;
+    case SDL_CONTROLLER_BUTTON_DPAD_UP:       return GBTN_DPAD_UP;
+    case SDL_CONTROLLER_BUTTON_DPAD_DOWN:     return GBTN_DPAD_DOWN;
+    case SDL_CONTROLLER_BUTTON_DPAD_LEFT:     return GBTN_DPAD_LEFT;
+    case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:    return GBTN_DPAD_RIGHT;
+
+    default:
+        return GBTN_NONE;
+    }
+}
+
+
+static bool hybrid_bound(int btn)
+{   // does the keyboard side do anything with this button right now.
+    const gptokeyb_button *button = state_button(btn);
+
+    if (button == NULL)
+        return false;
+
+    return (button->keycode != 0 || button->action != ACT_NONE);
+}
+
+
+static bool hybrid_stick_bound(int mode, int gbtn_up)
+{
+    if (mode != MOUSE_MOVEMENT_OFF)
+        return true;
+
+    for (int i=0; i < 4; i++)
+    {
+        if (hybrid_bound(gbtn_up + i))
+            return true;
+    }
+
+    return false;
+}
+
+
+static void hybrid_set_axis_route(int axis, bool keyboard)
+{
+    Uint8 route = (keyboard ? HYBRID_ROUTE_KEYBOARD : HYBRID_ROUTE_PAD);
+
+    if (hybrid_axis_route[axis] == HYBRID_ROUTE_PAD && route == HYBRID_ROUTE_KEYBOARD)
+    {   // the pad won't hear from this axis for a while, let it go back to the middle.
+        SDL_Event event;
+
+        memset(&event, 0, sizeof(event));
+        event.type = SDL_CONTROLLERAXISMOTION;
+        event.caxis.axis = axis;
+        event.caxis.value = 0;
+
+        handleEventAxisFakeXbox360Device(&event);
+    }
+
+    hybrid_axis_route[axis] = route;
+}
+
+
+void hybrid_update_routes()
+{   // called from state_change_update().
+    if (!hybrid_mode)
+        return;
+
+    for (int sdl_button=0; sdl_button < SDL_CONTROLLER_BUTTON_MAX; sdl_button++)
+    {
+        int btn = hybrid_button_gbtn(sdl_button);
+
+        if (btn == GBTN_NONE)
+            hybrid_button_route[sdl_button] = HYBRID_ROUTE_NONE;
+
+        else if (GBTN_IS_DPAD(btn) && current_dpad_mode != MOUSE_MOVEMENT_OFF)
+            hybrid_button_route[sdl_button] = HYBRID_ROUTE_KEYBOARD;
+
+        else
+            hybrid_button_route[sdl_button] = (hybrid_bound(btn) ? HYBRID_ROUTE_KEYBOARD : HYBRID_ROUTE_PAD);
+    }
+
+    bool left_analog = hybrid_stick_bound(current_left_analog_mode, GBTN_LEFT_ANALOG_UP);
+    bool right_analog = hybrid_stick_bound(current_right_analog_mode, GBTN_RIGHT_ANALOG_UP);
+
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_LEFTX, left_analog);
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_LEFTY, left_analog);
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_RIGHTX, right_analog);
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_RIGHTY, right_analog);
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_TRIGGERLEFT, (hybrid_bound(GBTN_L2) || hybrid_bound(GBTN_L2_FULL)));
+    hybrid_set_axis_route(SDL_CONTROLLER_AXIS_TRIGGERRIGHT, (hybrid_bound(GBTN_R2) || hybrid_bound(GBTN_R2_FULL)));
+}
+
+
+void hybrid_button_event(const SDL_Event *event, bool pressed)
+{
+    int sdl_button = event->cbutton.button;
+
+    if (sdl_button < 0 || sdl_button >= SDL_CONTROLLER_BUTTON_MAX)
+        return;
+
+    if (pressed)
+        hybrid_button_latched[sdl_button] = (hybrid_button_route[sdl_button] == HYBRID_ROUTE_PAD);
+
+    if (hybrid_button_latched[sdl_button])
+        handleEventBtnFakeXbox360Device(event, pressed);
+
+    if (!pressed)
+        hybrid_button_latched[sdl_button] = false;
+
+    handleEventBtnFakeKeyboardMouseDevice(event, pressed);
+}
+
+
+void hybrid_axis_event(const SDL_Event *event)
+{
+    int axis = event->caxis.axis;
+
+    if (axis < 0 || axis >= SDL_CONTROLLER_AXIS_MAX)
+        return;
+
+    if (hybrid_axis_route[axis] == HYBRID_ROUTE_PAD)
+        handleEventAxisFakeXbox360Device(event);
+
+    handleEventAxisFakeKeyboardMouseDevice(event);
+}
@@ -38,16 +38,82 @@
 #include "gptokeyb2.h"
 
 
+static void mark_keycode(bool *used, int keycode)
+{
+    if (keycode > 0 && keycode <= KEY_MAX)
+        used[keycode] = true;
+}
+
+
+static int setupFakeKeyboardKeys(int fd)
+{   // only turn on the keys that something in the config can press.
+    bool used[KEY_MAX + 1];
+    int count = 0;
+
+    memset(used, 0, sizeof(used));
+
+    for (gptokeyb_config *current = root_config; current != NULL; current = current->next)
+    {
+        for (int btn=0; btn < GBTN_MAX; btn++)
+        {
+            const gptokeyb_button *button = &current->button[btn];
+
+            mark_keycode(used, button->keycode);
+
+            if ((button->modifier & MOD_SHIFT) != 0)
+                mark_keycode(used, KEY_LEFTSHIFT);
+
+            if ((button->modifier & MOD_CTRL) != 0)
+                mark_keycode(used, KEY_LEFTCTRL);
+
+            if ((button->modifier & MOD_ALT) != 0)
+                mark_keycode(used, KEY_LEFTALT);
+
+            for (int zone=0; zone < button->zone_count; zone++)
+            {
+                for (int key=0; key < button->zones[zone].key_count; key++)
+                    mark_keycode(used, button->zones[zone].keycodes[key]);
+            }
+
+            if (button->action == ACT_RADIAL_MENU)
+            {
+                for (int key=0; key < button->radial_count; key++)
+                    mark_keycode(used, button->radial_keys[key]);
+            }
+        }
+    }
+
+    if (want_pc_quit)
+    {
+        mark_keycode(used, KEY_F4);
+        mark_keycode(used, KEY_LEFTALT);
+    }
+
+    mark_keycode(used, BTN_LEFT);
+    mark_keycode(used, BTN_RIGHT);
+
+    for (int keycode=0; keycode <= KEY_MAX; keycode++)
+    {
+        if (!used[keycode])
+            continue;
+
+        ioctl(fd, UI_SET_KEYBIT, keycode);
+        count++;
+    }
+
+    return count;
+}
+
+
 void setupFakeKeyboardMouseDevice(struct uinput_user_dev *device, int fd)
 {
     strncpy(device->name, "Fake Keyboard", UINPUT_MAX_NAME_SIZE);
     device->id.vendor = 0x1234;  /* sample vendor */
     device->id.product = 0x5678; /* sample product */
 
-    for (int i = 0; i < 256; i++)
-    {
-        ioctl(fd, UI_SET_KEYBIT, i);
-    }
+    int key_count = setupFakeKeyboardKeys(fd);
+
+    GPTK2_DEBUG("Fake Keyboard: %d keys\n", key_count);
 
     // Keys or Buttons
     ioctl(fd, UI_SET_EVBIT, EV_KEY);
@@ -57,8 +123,26 @@ void setupFakeKeyboardMouseDevice(struct uinput_user_dev *device, int fd)
     ioctl(fd, UI_SET_EVBIT, EV_REL);
     ioctl(fd, UI_SET_RELBIT, REL_X);
     ioctl(fd, UI_SET_RELBIT, REL_Y);
-    ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
-    ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT);
+    ioctl(fd, UI_SET_RELBIT, REL_WHEEL);
+    ioctl(fd, UI_SET_RELBIT, REL_HWHEEL);
+#ifdef REL_WHEEL_HI_RES
+    ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+    ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES);
+#endif
+
+    if (current_state.kernel_repeat)
+        ioctl(fd, UI_SET_EVBIT, EV_REP);
+}
+
+
+void setupFakeKeyboardRepeat()
+{   // call after UI_DEV_CREATE, the kernel repeats held keys from here on.
+    if (!current_state.kernel_repeat)
+        return;
+
+    emit(EV_REP, REP_DELAY, (int)(current_state.repeat_delay));
+    emit(EV_REP, REP_PERIOD, (int)(current_state.repeat_rate));
+    emit(EV_SYN, SYN_REPORT, 0);
 }
 
 
@@ -68,71 +152,184 @@ void handleEventBtnFakeKeyboardMouseDevice(const SDL_Event *event, bool pressed)
     switch (event->cbutton.button)
     {
     case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-        update_button(GBTN_DPAD_LEFT, pressed);
+        debounce_button(GBTN_DPAD_LEFT, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_DPAD_UP:
-        update_button(GBTN_DPAD_UP, pressed);
+        debounce_button(GBTN_DPAD_UP, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-        update_button(GBTN_DPAD_RIGHT, pressed);
+        debounce_button(GBTN_DPAD_RIGHT, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-        update_button(GBTN_DPAD_DOWN, pressed);
+        debounce_button(GBTN_DPAD_DOWN, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_A:
-        update_button(GBTN_A, pressed);
+        debounce_button(GBTN_A, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_B:
-        update_button(GBTN_B, pressed);
+        debounce_button(GBTN_B, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_X:
-        update_button(GBTN_X, pressed);
+        debounce_button(GBTN_X, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_Y:
-        update_button(GBTN_Y, pressed);
+        debounce_button(GBTN_Y, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
-        update_button(GBTN_L1, pressed);
+        debounce_button(GBTN_L1, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
-        update_button(GBTN_R1, pressed);
+        debounce_button(GBTN_R1, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_LEFTSTICK:
-        update_button(GBTN_L3, pressed);
+        debounce_button(GBTN_L3, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
-        update_button(GBTN_R3, pressed);
+        debounce_button(GBTN_R3, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_GUIDE:
-        update_button(GBTN_GUIDE, pressed);
+        debounce_button(GBTN_GUIDE, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_BACK: // aka select
-        update_button(GBTN_BACK, pressed);
+        debounce_button(GBTN_BACK, pressed);
         break;
 
     case SDL_CONTROLLER_BUTTON_START:
-        update_button(GBTN_START, pressed);
+        debounce_button(GBTN_START, pressed);
         break;
     } //switch
 }
 
 
-#define _ANALOG_AXIS_ZERO(ANALOG_VALUE, DEADZONE) (abs(ANALOG_VALUE) < DEADZONE)
-#define _ANALOG_AXIS_POS(ANALOG_VALUE, DEADZONE)  (!_ANALOG_AXIS_ZERO(ANALOG_VALUE, DEADZONE) && ((ANALOG_VALUE) > DEADZONE))
-#define _ANALOG_AXIS_NEG(ANALOG_VALUE, DEADZONE)  (!_ANALOG_AXIS_ZERO(ANALOG_VALUE, DEADZONE) && ((ANALOG_VALUE) < DEADZONE))
+static int analog_pwm_duty(float amount)
+{
+    if (amount <= 0.0f)
+        return 0;
+
+    if (amount >= 1.0f)
+        return PWM_DUTY_MAX;
+
+    return (int)(amount * (float)(PWM_DUTY_MAX));
+}
+
+
+static void update_analog_pwm(int gbtn_up, int x, int y)
+{   // how far the stick is pushed in each direction, for buttons bound with pwm.
+    float stick_x;
+    float stick_y;
+
+    deadzone_mouse_calc(&stick_x, &stick_y, x, y);
+
+    stick_x /= (float)(current_state.deadzone_scale);
+    stick_y /= (float)(current_state.deadzone_scale);
+
+    current_state.pwm_duty[gbtn_up + 0] = analog_pwm_duty(-stick_y);
+    current_state.pwm_duty[gbtn_up + 1] = analog_pwm_duty( stick_y);
+    current_state.pwm_duty[gbtn_up + 2] = analog_pwm_duty(-stick_x);
+    current_state.pwm_duty[gbtn_up + 3] = analog_pwm_duty( stick_x);
+}
+
+
+static void update_analog_directions(int gbtn_up, int *sector, int x, int y)
+{   // only touch the direction buttons that actually changed.
+    int last_mask = (current_state.pressed >> gbtn_up) & 0x0F;
+    int mask = analog_direction_mask(sector, x, y, last_mask);
+    int changed = (mask ^ last_mask);
+
+    for (int i=0; i < 4; i++)
+    {
+        if ((changed & (1<<i)) != 0)
+            update_button(gbtn_up + i, (mask & (1<<i)) != 0);
+    }
+
+    if (mask == 0)
+        return;
+
+    Sint64 magnitude_sq = ((Sint64)(x) * (Sint64)(x)) + ((Sint64)(y) * (Sint64)(y));
+
+    for (int i=0; i < 4; i++)
+    {
+        if ((mask & (1<<i)) != 0)
+            update_button_zone(gbtn_up + i, magnitude_sq);
+    }
+}
+
+static void update_analog_scroll(int stick_id, int x, int y)
+{   // same deadzone as the mouse, but scaled to -1.0 .. 1.0.
+    deadzone_mouse_calc(&current_state.scroll_x[stick_id], &current_state.scroll_y[stick_id], x, y);
+
+    current_state.scroll_x[stick_id] /= (float)(current_state.deadzone_scale);
+    current_state.scroll_y[stick_id] /= (float)(current_state.deadzone_scale);
+}
+
+static void update_analog_stick(int stick_id, int mode, int x, int y)
+{   // each stick is handled on its own, so both can be a mouse at the same time.
+    switch (mode)
+    {
+    case MOUSE_MOVEMENT_ON:
+        // fake mouse, mouse_update() adds up the sticks every tick.
+        deadzone_mouse_calc(
+            &current_state.analog_mouse_x[stick_id], &current_state.analog_mouse_y[stick_id], x, y);
+        break;
+
+    case MOUSE_MOVEMENT_SCROLL:
+        update_analog_scroll(stick_id, x, y);
+        break;
+
+    case MOUSE_MOVEMENT_ABSOLUTE:
+        pointer_stick_update(x, y);
+        break;
+
+    case MOUSE_MOVEMENT_FLICK:
+        flick_stick_update(stick_id, x, y);
+        break;
+
+    default:
+        if (stick_id == 0)
+        {
+            if (current_left_analog_pwm)
+                update_analog_pwm(GBTN_LEFT_ANALOG_UP, x, y);
+
+            update_analog_directions(GBTN_LEFT_ANALOG_UP, &current_state.left_analog_sector, x, y);
+        }
+        else
+        {
+            if (current_right_analog_pwm)
+                update_analog_pwm(GBTN_RIGHT_ANALOG_UP, x, y);
+
+            update_analog_directions(GBTN_RIGHT_ANALOG_UP, &current_state.right_analog_sector, x, y);
+        }
+        break;
+    }
+}
+
+
+static void update_trigger_stages(int gbtn_half, int gbtn_full, int value)
+{
+    int last_mask = (is_pressed(gbtn_half) ? TRIGGER_MASK_HALF : 0) | (is_pressed(gbtn_full) ? TRIGGER_MASK_FULL : 0);
+    int mask = deadzone_trigger_calc(value, last_mask);
+    int changed = (mask ^ last_mask);
+
+    if ((changed & TRIGGER_MASK_HALF) != 0)
+        update_button(gbtn_half, (mask & TRIGGER_MASK_HALF) != 0);
+
+    if ((changed & TRIGGER_MASK_FULL) != 0)
+        update_button(gbtn_full, (mask & TRIGGER_MASK_FULL) != 0);
+}
+
 
 void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event *event)
 {
@@ -144,22 +341,22 @@ void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event *event)
     switch (event->caxis.axis)
     {
     case SDL_CONTROLLER_AXIS_LEFTX:
-        current_state.current_left_analog_x = event->caxis.value;
+        current_state.raw_left_analog_x = event->caxis.value;
         left_axis_movement = true;
         break;
 
     case SDL_CONTROLLER_AXIS_LEFTY:
-        current_state.current_left_analog_y = event->caxis.value;
+        current_state.raw_left_analog_y = event->caxis.value;
         left_axis_movement = true;
         break;
 
     case SDL_CONTROLLER_AXIS_RIGHTX:
-        current_state.current_right_analog_x = event->caxis.value;
+        current_state.raw_right_analog_x = event->caxis.value;
         right_axis_movement = true;
         break;
 
     case SDL_CONTROLLER_AXIS_RIGHTY:
-        current_state.current_right_analog_y = event->caxis.value;
+        current_state.raw_right_analog_y = event->caxis.value;
         right_axis_movement = true;
         break;
 
@@ -174,40 +371,49 @@ void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event *event)
         break;
     } // switch (event->caxis.axis)
 
-    // fake mouse
-    if (current_left_analog_as_mouse && left_axis_movement)
+    if (left_axis_movement)
     {
-        deadzone_mouse_calc(
-            &current_state.mouse_x, &current_state.mouse_y,
-            current_state.current_left_analog_x, current_state.current_left_analog_y);
+        current_state.current_left_analog_x = current_state.raw_left_analog_x;
+        current_state.current_left_analog_y = current_state.raw_left_analog_y;
+        calibrate_stick(0, &current_state.current_left_analog_x, &current_state.current_left_analog_y);
     }
-    else if (current_right_analog_as_mouse && right_axis_movement)
+
+    if (right_axis_movement)
     {
-        deadzone_mouse_calc(
-            &current_state.mouse_x, &current_state.mouse_y,
-            current_state.current_right_analog_x, current_state.current_right_analog_y);
+        current_state.current_right_analog_x = current_state.raw_right_analog_x;
+        current_state.current_right_analog_y = current_state.raw_right_analog_y;
+        calibrate_stick(1, &current_state.current_right_analog_x, &current_state.current_right_analog_y);
     }
-    else
-    {
-        if (left_axis_movement)
+
+    if (current_state.radial_menu != NULL)
+    {   // a radial menu is open, its stick only picks from the menu.
+        if (current_state.radial_menu->radial_stick == 0 && left_axis_movement)
         {
-            update_button(GBTN_LEFT_ANALOG_UP,    _ANALOG_AXIS_NEG(current_state.current_left_analog_y, current_state.deadzone_y));
-            update_button(GBTN_LEFT_ANALOG_DOWN,  _ANALOG_AXIS_POS(current_state.current_left_analog_y, current_state.deadzone_y));
-            update_button(GBTN_LEFT_ANALOG_LEFT,  _ANALOG_AXIS_NEG(current_state.current_left_analog_x, current_state.deadzone_x));
-            update_button(GBTN_LEFT_ANALOG_RIGHT, _ANALOG_AXIS_POS(current_state.current_left_analog_x, current_state.deadzone_x));
+            radial_menu_update(current_state.current_left_analog_x, current_state.current_left_analog_y);
+            left_axis_movement = false;
         }
-        if (right_axis_movement)
+        else if (current_state.radial_menu->radial_stick == 1 && right_axis_movement)
         {
-            update_button(GBTN_RIGHT_ANALOG_UP,    _ANALOG_AXIS_NEG(current_state.current_right_analog_y, current_state.deadzone_y));
-            update_button(GBTN_RIGHT_ANALOG_DOWN,  _ANALOG_AXIS_POS(current_state.current_right_analog_y, current_state.deadzone_y));
-            update_button(GBTN_RIGHT_ANALOG_LEFT,  _ANALOG_AXIS_NEG(current_state.current_right_analog_x, current_state.deadzone_x));
-            update_button(GBTN_RIGHT_ANALOG_RIGHT, _ANALOG_AXIS_POS(current_state.current_right_analog_x, current_state.deadzone_x));
+            radial_menu_update(current_state.current_right_analog_x, current_state.current_right_analog_y);
+            right_axis_movement = false;
         }
-    } // Analogs trigger keys 
+    }
+
+    if (left_axis_movement)
+    {
+        update_analog_stick(0, current_left_analog_mode,
+            current_state.current_left_analog_x, current_state.current_left_analog_y);
+    }
+
+    if (right_axis_movement)
+    {
+        update_analog_stick(1, current_right_analog_mode,
+            current_state.current_right_analog_x, current_state.current_right_analog_y);
+    }
 
     if (l2_movement)
-        update_button(GBTN_L2, current_state.current_l2 > current_state.deadzone_triggers);
+        update_trigger_stages(GBTN_L2, GBTN_L2_FULL, current_state.current_l2);
 
     if (r2_movement)
-        update_button(GBTN_R2, current_state.current_r2 > current_state.deadzone_triggers);
+        update_trigger_stages(GBTN_R2, GBTN_R2_FULL, current_state.current_r2);
 }
@@ -281,6 +281,9 @@ const button_match button_codes[] = {
     {"right_analog_left", GBTN_RIGHT_ANALOG_LEFT},
     {"right_analog_right", GBTN_RIGHT_ANALOG_RIGHT},
 
+    {"l2_full", GBTN_L2_FULL},
+    {"r2_full", GBTN_R2_FULL},
+
     {"dpad", GBTN_DPAD},
     {"left_analog", GBTN_LEFT_ANALOG},
     {"right_analog", GBTN_RIGHT_ANALOG},
@@ -46,6 +46,7 @@
 int uinp_fd=0;
 bool xbox360_mode=false;
 bool config_mode=false;
+bool hybrid_mode=false;
 
 bool want_pc_quit = false;
 bool want_kill = false;
@@ -68,6 +69,7 @@ int main(int argc, char* argv[])
 
     string_init();
     state_init();
+    analog_init();
     config_init();
     input_init();
 
@@ -114,7 +116,7 @@ int main(int argc, char* argv[])
     int opt;
     char default_control[MAX_CONTROL_NAME] = "";
 
-    while ((opt = getopt(argc, argv, "vk1g:hdxp:c:ZXPH:s:")) != -1)
+    while ((opt = getopt(argc, argv, "vk1g:hdxyp:c:ZXPH:s:")) != -1)
     {
         switch (opt)
         {
@@ -195,6 +197,10 @@ int main(int argc, char* argv[])
             xbox360_mode = true;
             break;
 
+        case 'y':
+            hybrid_mode = true;
+            break;
+
         case 'p':
             strncpy(default_control, optarg, MAX_CONTROL_NAME-1);
             printf("using control %s\n", default_control);
@@ -221,6 +227,7 @@ int main(int argc, char* argv[])
             fprintf(stderr, "\n");
             fprintf(stderr, "  -g  \"game_prefix\"   - game prefix used to allow per-game config.\n");
             fprintf(stderr, "  -x                  - xbox360 mode.\n");
+            fprintf(stderr, "  -y                  - hybrid mode, xbox360 pad and keyboard together (needs -c).\n");
             fprintf(stderr, "  -c  \"config.ini\"    - config file to load.\n");
             fprintf(stderr, "  -p  \"control\"       - what control mode to start in.\n");
             fprintf(stderr, "\n");
@@ -237,6 +244,21 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (hybrid_mode)
+    {
+        if (config_mode)
+        {
+            xbox360_mode = false;
+        }
+        else
+        {
+            printf("Hybrid mode needs a config file, using xbox360 mode.\n");
+            hybrid_mode = false;
+            config_mode = false;
+            xbox360_mode = true;
+        }
+    }
+
     for (int index=optind, i=0; index < argc; index++, i++)
     {
         if (i == 0)
@@ -271,6 +293,18 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (xbox360_mode && !do_dump_config && access(user_config_file, F_OK) == 0)
+    {   // only the [config] settings are used, the controls get cleared.
+        printf("Loading '%s'\n", user_config_file);
+
+        if (config_load(user_config_file, true))
+        {
+            config_quit();
+            string_quit();
+            return 1;
+        }
+    }
+
     if (config_mode)
     {
         if (!do_dump_config && access(user_config_file, F_OK) == 0)
@@ -315,6 +349,10 @@ int main(int argc, char* argv[])
     }
 
     config_finalise();
+    analog_finalise();
+    mouse_finalise();
+    debounce_finalise();
+    xbox_finalise();
     state_change_update();
 
     if (do_dump_config)
@@ -341,40 +379,101 @@ int main(int argc, char* argv[])
     //if (!kill_mode) {  
     if (config_mode || xbox360_mode)
     {   // initialise device, even in kill mode, now that kill mode will work with config & xbox modes
-        uinp_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+        Uint64 startup_us = timer_now_us();
 
-        if (uinp_fd < 0)
-        {
-            printf("Unable to open /dev/uinput\n");
-            return -1;
-        }
-
-        // Intialize the uInput device to NULL
-        memset(&uidev, 0, sizeof(uidev));
-        uidev.id.version = 1;
-        uidev.id.bustype = BUS_USB;
-
-        if (xbox360_mode)
-        {
-            printf("Running in Fake Xbox 360 Mode\n");
-            setupFakeXbox360Device(&uidev, uinp_fd);
+        if (current_state.output_sink != OUTPUT_SINK_UINPUT)
+        {   // no devices, everything runs as normal but ends up in the sink.
+            printf("Using %s output sink\n", output_sink_str(current_state.output_sink));
+            uinp_fd = -1;
 
-            // make sure :D
-            config_overlay_clear(root_config);
+            if (xbox360_mode)
+                config_overlay_clear(root_config);
         }
         else
         {
-            printf("Running in Fake Keyboard mode\n");
-            setupFakeKeyboardMouseDevice(&uidev, uinp_fd);
-        }
+            // the pad reads rumble requests back from the device.
+            uinp_fd = open("/dev/uinput", (xbox360_mode ? O_RDWR : O_WRONLY) | O_NONBLOCK);
+
+            if (uinp_fd < 0)
+            {
+                printf("Unable to open /dev/uinput\n");
+                return -1;
+            }
+
+            // Intialize the uInput device to NULL
+            memset(&uidev, 0, sizeof(uidev));
+            uidev.id.version = 1;
+            uidev.id.bustype = BUS_USB;
+
+            if (xbox360_mode)
+            {
+                printf("Running in Fake Xbox 360 Mode\n");
+                setupFakeXbox360Device(&uidev, uinp_fd);
+                setupFakeXbox360Rumble(&uidev, uinp_fd);
+
+                // make sure :D
+                config_overlay_clear(root_config);
+            }
+            else
+            {
+                printf("Running in Fake Keyboard mode\n");
+                setupFakeKeyboardMouseDevice(&uidev, uinp_fd);
+            }
+
+            // Create input device into input sub-system
+            if (uinput_create(uinp_fd, &uidev)) {
+                printf("Unable to create UINPUT device.");
+                return -1;
+            }
+
+            if (hybrid_mode)
+            {   // the pad gets its own device.
+                struct uinput_user_dev xbox_dev;
+
+                printf("Running in Hybrid mode\n");
+
+                xbox_fd = open("/dev/uinput", O_RDWR | O_NONBLOCK);
+
+                if (xbox_fd < 0)
+                {
+                    printf("Unable to open /dev/uinput\n");
+                    return -1;
+                }
+
+                memset(&xbox_dev, 0, sizeof(xbox_dev));
+                xbox_dev.id.version = 1;
+                xbox_dev.id.bustype = BUS_USB;
+
+                setupFakeXbox360Device(&xbox_dev, xbox_fd);
+                setupFakeXbox360Rumble(&xbox_dev, xbox_fd);
 
-        // Create input device into input sub-system
-        write(uinp_fd, &uidev, sizeof(uidev));
+                if (uinput_create(xbox_fd, &xbox_dev)) {
+                    printf("Unable to create UINPUT device.");
+                    return -1;
+                }
 
-        if (ioctl(uinp_fd, UI_DEV_CREATE)) {
-            printf("Unable to create UINPUT device.");
-            return -1;
+                output_device(OUTPUT_DEVICE_PAD, xbox_fd);
+            }
         }
+
+        if (!xbox360_mode)
+            pointer_init();
+
+        output_init(uinp_fd);
+
+        if (xbox360_mode && uinp_fd >= 0)
+            rumble_init(uinp_fd);
+
+        else if (xbox_fd >= 0)
+            rumble_init(xbox_fd);
+
+        if (!xbox360_mode)
+            setupFakeKeyboardRepeat();
+
+        if (current_state.output_benchmark)
+            output_benchmark();
+
+        printf("Created input devices in %.1f ms\n", (float)(timer_now_us() - startup_us) / 1000.0f);
     }
 
     const char* db_file = SDL_getenv("SDL_GAMECONTROLLERCONFIG_FILE");
@@ -384,10 +483,9 @@ int main(int argc, char* argv[])
     }
 
     SDL_Event event;
-    int mouse_x=0;
-    int mouse_y=0;
-    vector2d mouse_move;
-    float slow_scale = (100.0 / (float)(current_state.mouse_slow_scale));
+    Uint64 next_tick_us = 0;
+
+    gyro_init();
 
     while (current_state.running)
     {
@@ -398,43 +496,62 @@ int main(int argc, char* argv[])
 
         state_update();
 
-        if (current_state.mouse_x != 0 || current_state.mouse_y != 0 || current_dpad_as_mouse || current_state.in_repeat)
+        // io_uring queues frames up until here.
+        output_submit();
+
+        bool mouse_active = (
+            current_state.analog_mouse_x[0] != 0 || current_state.analog_mouse_y[0] != 0 ||
+            current_state.analog_mouse_x[1] != 0 || current_state.analog_mouse_y[1] != 0 ||
+            current_state.scroll_x[0] != 0 || current_state.scroll_y[0] != 0 ||
+            current_state.scroll_x[1] != 0 || current_state.scroll_y[1] != 0 ||
+            current_state.mouse_move || current_state.in_repeat ||
+            gyro_active() || touchpad_active() || flick_active() || pointer_active());
+
+        Uint64 deadline_us = state_next_deadline();
+
+        if (mouse_active)
         {
-            mouse_x = current_state.mouse_x;
-            mouse_y = current_state.mouse_y;
+            Uint64 now_us = timer_now_us();
 
-            if (current_dpad_as_mouse > 0)
+            if (next_tick_us == 0 || now_us >= next_tick_us)
             {
-                vector2d_clear(&mouse_move);
+                mouse_update();
+                output_submit();
 
-                mouse_move.x -= (is_pressed(GBTN_DPAD_LEFT ) ? 1.0f : 0.0f);
-                mouse_move.x += (is_pressed(GBTN_DPAD_RIGHT) ? 1.0f : 0.0f);
-                mouse_move.y -= (is_pressed(GBTN_DPAD_UP   ) ? 1.0f : 0.0f);
-                mouse_move.y += (is_pressed(GBTN_DPAD_DOWN ) ? 1.0f : 0.0f);
+                Uint64 tick_us = (Uint64)(flick_active() ? current_state.flick_tick : current_state.mouse_delay) * 1000;
 
-                if (current_state.dpad_mouse_normalize)
-                    vector2d_normalize(&mouse_move);
+                // start again from now if we were idle or fell more than a tick behind.
+                if (next_tick_us == 0 || now_us > next_tick_us + tick_us)
+                    next_tick_us = now_us;
 
-                mouse_x += (int)(mouse_move.x * current_state.dpad_mouse_step);
-                mouse_y += (int)(mouse_move.y * current_state.dpad_mouse_step);
+                next_tick_us += tick_us;
             }
 
-            if (current_state.mouse_slow)
-            {
-                mouse_x = (int)((float)(mouse_x) / slow_scale);
-                mouse_y = (int)((float)(mouse_y) / slow_scale);
-            }
+            if (deadline_us == 0 || next_tick_us < deadline_us)
+                deadline_us = next_tick_us;
 
-            // if (mouse_x != 0 || mouse_y != 0)
-            //     GPTK2_DEBUG("mouse move %d %d\n", mouse_x, mouse_y);
+            // sleep.
+            timer_sleep_until(deadline_us);
+        }
+        else if (deadline_us != 0)
+        {   // only pwm keys running, wait for an event but wake up for the next edge.
+            Uint64 now_us = timer_now_us();
+            int wait_ms = ((deadline_us > now_us) ? (int)((deadline_us - now_us) / 1000) : 0);
 
-            emitMouseMotion(mouse_x, mouse_y);
+            mouse_reset();
+            next_tick_us = 0;
 
-            // sleep.
-            SDL_Delay(16);
+            if (wait_ms == 0)
+                timer_sleep_until(deadline_us);
+
+            else if (SDL_WaitEventTimeout(&event, wait_ms))
+                handleInputEvent(&event);
         }
         else
         {
+            mouse_reset();
+            next_tick_us = 0;
+
             // GPTK2_DEBUG("-- WAIT FOR EVENT --\n");
             if (!SDL_WaitEvent(&event))
             {
@@ -446,18 +563,44 @@ int main(int argc, char* argv[])
         }
     }
 
+    rumble_quit();
     SDL_Quit();
 
-    /*
-        * Give userspace some time to read the events before we destroy the
-        * device with UI_DEV_DESTROY.
-        */
-    sleep(1);
+    if (config_mode || xbox360_mode)
+    {
+        Uint64 shutdown_us = timer_now_us();
+
+        /*
+            * Let go of anything still held, then give userspace some time to
+            * read the events before we destroy the device with UI_DEV_DESTROY.
+            */
+        emit_release_all();
+        emit_drain();
+        output_quit();
+
+        /* Clean up */
+        if (uinp_fd >= 0)
+        {
+            ioctl(uinp_fd, UI_DEV_DESTROY);
+            close(uinp_fd);
+        }
 
-    /* Clean up */
-    ioctl(uinp_fd, UI_DEV_DESTROY);
-    close(uinp_fd);
+        if (xbox_fd >= 0)
+        {
+            ioctl(xbox_fd, UI_DEV_DESTROY);
+            close(xbox_fd);
+            xbox_fd = -1;
+        }
+
+        pointer_quit();
+
+        printf("Removed input devices in %.1f ms\n", (float)(timer_now_us() - shutdown_us) / 1000.0f);
+    }
 
+    debounce_report();
+    emit_report();
+    calibrate_quit();
+    gyro_quit();
     config_quit();
     // state_quit();
     // input_quit();
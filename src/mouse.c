@@ -0,0 +1,434 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Mouse integrator.
+ *
+ * current_state.analog_mouse_x / analog_mouse_y are velocities in pixels per
+ * MOUSE_REFERENCE_DELAY ms for each stick, this turns them into pixels using the real time
+ * between ticks. Anything less than a pixel is carried over to the next tick
+ * so slow movements and mouse_slow still move the cursor.
+ */
+
+// Never integrate more than this in one go, stops the cursor jumping after a stall.
+#define MOUSE_MAX_DT 0.1f
+
+typedef struct
+{
+    int mode;
+    Uint32 delay;
+    float inv_time;
+    float gain;
+
+    bool held;
+    Uint32 held_since;
+} mouse_accel_profile;
+
+static float mouse_slow_scale = 2.0f;
+static float mouse_stick_scale[2] = {1.0f, 1.0f};
+static float mouse_remainder_x = 0.0f;
+static float mouse_remainder_y = 0.0f;
+static float mouse_wheel_remainder = 0.0f;
+static float mouse_hwheel_remainder = 0.0f;
+static int mouse_wheel_detent = 0;
+static int mouse_hwheel_detent = 0;
+static float mouse_scroll_scale = 0.0f;
+static Uint64 mouse_last_us = 0;
+
+static mouse_accel_profile mouse_stick_accel;
+static mouse_accel_profile mouse_dpad_accel;
+
+/* Flick stick.
+ *
+ * Pushing the stick out to the rim turns the camera to face where the stick
+ * points (up is straight ahead), spread over flick_time ms. Rotating the stick
+ * around the rim then turns the camera by the same angle. flick_turn is how
+ * many pixels of mouse movement make one full turn in the game.
+ */
+
+// binary angle of the stick pushed straight up.
+#define FLICK_ANGLE_FORWARD ((Uint16)(ANALOG_ANGLE_FULL * 3 / 4))
+
+typedef struct
+{
+    bool on_rim;
+    bool wait_center;
+    Uint16 last_angle;
+
+    float target;
+    float done;
+    Uint64 start_us;
+} flick_stick_state;
+
+static flick_stick_state flick_sticks[2];
+static float flick_scale = 0.0f;
+static Uint64 flick_time_us = 0;
+static Sint64 flick_enter_sq = 0;
+static Sint64 flick_exit_sq = 0;
+static float flick_remainder_x = 0.0f;
+
+
+int mouse_accel_get_mode(const char *str)
+{
+    if (strcasecmp(str, "ramp") == 0)
+        return MOUSE_ACCEL_RAMP;
+
+    else if (strcasecmp(str, "squared") == 0)
+        return MOUSE_ACCEL_SQUARED;
+
+    // default
+    return MOUSE_ACCEL_CONSTANT;
+}
+
+
+const char *mouse_accel_mode_str(int mode)
+{
+    switch(mode)
+    {
+    default:
+    case MOUSE_ACCEL_CONSTANT:
+        return "constant";
+
+    case MOUSE_ACCEL_RAMP:
+        return "ramp";
+
+    case MOUSE_ACCEL_SQUARED:
+        return "squared";
+    }
+}
+
+
+static void mouse_accel_compile(mouse_accel_profile *profile, int mode, int delay, int time, int max)
+{
+    profile->mode = mode;
+    profile->delay = (Uint32)(delay);
+    profile->inv_time = 1.0f / (float)(time);
+    profile->gain = ((float)(max) / 100.0f) - 1.0f;
+    profile->held = false;
+}
+
+
+static float mouse_accel_scale(mouse_accel_profile *profile, bool moving, Uint32 ticks)
+{   /* How much to multiply the speed by, based on how long this source has been moving. */
+    if (!moving)
+    {
+        profile->held = false;
+        return 1.0f;
+    }
+
+    if (!profile->held)
+    {
+        profile->held = true;
+        profile->held_since = ticks;
+    }
+
+    if (profile->mode == MOUSE_ACCEL_CONSTANT)
+        return 1.0f;
+
+    Uint32 held = ticks - profile->held_since;
+
+    if (held <= profile->delay)
+        return 1.0f;
+
+    float amount = (float)(held - profile->delay) * profile->inv_time;
+
+    if (amount > 1.0f)
+        amount = 1.0f;
+
+    if (profile->mode == MOUSE_ACCEL_SQUARED)
+        amount *= amount;
+
+    return 1.0f + (profile->gain * amount);
+}
+
+
+void mouse_finalise()
+{   // call after the config is loaded
+    mouse_slow_scale = (100.0f / (float)(current_state.mouse_slow_scale));
+    mouse_stick_scale[0] = (float)(current_state.left_analog_mouse_scale) / 100.0f;
+    mouse_stick_scale[1] = (float)(current_state.right_analog_mouse_scale) / 100.0f;
+    mouse_scroll_scale = (float)(current_state.scroll_speed * MOUSE_WHEEL_DETENT);
+
+    mouse_accel_compile(&mouse_stick_accel,
+        current_state.mouse_accel,
+        current_state.mouse_accel_delay,
+        current_state.mouse_accel_time,
+        current_state.mouse_accel_max);
+
+    mouse_accel_compile(&mouse_dpad_accel,
+        current_state.dpad_mouse_accel,
+        current_state.dpad_mouse_accel_delay,
+        current_state.dpad_mouse_accel_time,
+        current_state.dpad_mouse_accel_max);
+
+    int flick_exit = current_state.flick_threshold - current_state.analog_hysteresis;
+
+    if (flick_exit < 0)
+        flick_exit = 0;
+
+    flick_scale = (float)(current_state.flick_turn) / (float)(ANALOG_ANGLE_FULL);
+    flick_time_us = (Uint64)(current_state.flick_time) * 1000;
+    flick_enter_sq = (Sint64)(current_state.flick_threshold) * (Sint64)(current_state.flick_threshold);
+    flick_exit_sq = (Sint64)(flick_exit) * (Sint64)(flick_exit);
+}
+
+
+void flick_stick_update(int stick_id, int x, int y)
+{   // called from the axis events of a stick set to flick_stick.
+    flick_stick_state *flick = &flick_sticks[stick_id];
+    Sint64 magnitude_sq = ((Sint64)(x) * (Sint64)(x)) + ((Sint64)(y) * (Sint64)(y));
+    Uint16 angle;
+
+    if (flick->wait_center)
+    {   // after a reset, the stick has to come back in before it can flick again.
+        if (magnitude_sq >= flick_exit_sq)
+            return;
+
+        flick->wait_center = false;
+    }
+
+    if (!flick->on_rim)
+    {
+        if (magnitude_sq < flick_enter_sq)
+            return;
+
+        angle = analog_angle(x, y);
+
+        // finish off any flick that is still turning before starting the next.
+        flick_remainder_x += flick->target - flick->done;
+
+        flick->on_rim = true;
+        flick->last_angle = angle;
+        flick->target = (float)((Sint16)(angle - FLICK_ANGLE_FORWARD)) * flick_scale;
+        flick->done = 0.0f;
+        flick->start_us = timer_now_us();
+        return;
+    }
+
+    if (magnitude_sq < flick_exit_sq)
+    {
+        flick->on_rim = false;
+        return;
+    }
+
+    angle = analog_angle(x, y);
+
+    // the Sint16 wrap gives the short way round.
+    flick_remainder_x += (float)((Sint16)(angle - flick->last_angle)) * flick_scale;
+    flick->last_angle = angle;
+}
+
+
+void flick_stick_reset(int stick_id)
+{   // stop a flick that is still turning, and don't flick again until the stick is let go.
+    flick_stick_state *flick = &flick_sticks[stick_id];
+
+    flick->on_rim = false;
+    flick->wait_center = true;
+    flick->target = flick->done;
+}
+
+
+bool flick_active()
+{   // true while a flick is still turning, the main loop ticks faster then.
+    if (flick_remainder_x != 0.0f)
+        return true;
+
+    for (int i=0; i < 2; i++)
+    {
+        if (flick_sticks[i].done != flick_sticks[i].target)
+            return true;
+    }
+
+    return false;
+}
+
+
+static void flick_take(float *x, Uint64 now_us)
+{
+    for (int i=0; i < 2; i++)
+    {
+        flick_stick_state *flick = &flick_sticks[i];
+
+        if (flick->done == flick->target)
+            continue;
+
+        float want = flick->target;
+        Uint64 elapsed_us = now_us - flick->start_us;
+
+        if (elapsed_us < flick_time_us)
+            want *= (float)(elapsed_us) / (float)(flick_time_us);
+
+        *x += want - flick->done;
+        flick->done = want;
+    }
+
+    *x += flick_remainder_x;
+    flick_remainder_x = 0.0f;
+}
+
+
+void mouse_reset()
+{   // the mouse has stopped, drop any leftovers so it starts fresh next time.
+    mouse_remainder_x = 0.0f;
+    mouse_remainder_y = 0.0f;
+    mouse_wheel_remainder = 0.0f;
+    mouse_hwheel_remainder = 0.0f;
+    mouse_wheel_detent = 0;
+    mouse_hwheel_detent = 0;
+    mouse_last_us = 0;
+
+    mouse_stick_accel.held = false;
+    mouse_dpad_accel.held = false;
+}
+
+
+void mouse_update()
+{
+    Uint64 now_us = timer_now_us();
+    Uint32 current_ticks = SDL_GetTicks();
+    float dt;
+    float scale;
+    vector2d mouse_move;
+
+    if (mouse_last_us == 0)
+        dt = (float)(current_state.mouse_delay) / 1000.0f;
+    else
+        dt = (float)(now_us - mouse_last_us) / 1000000.0f;
+
+    if (dt > MOUSE_MAX_DT)
+        dt = MOUSE_MAX_DT;
+
+    mouse_last_us = now_us;
+
+    vector2d_set_float2(&mouse_move,
+        (current_state.analog_mouse_x[0] * mouse_stick_scale[0]) + (current_state.analog_mouse_x[1] * mouse_stick_scale[1]),
+        (current_state.analog_mouse_y[0] * mouse_stick_scale[0]) + (current_state.analog_mouse_y[1] * mouse_stick_scale[1]));
+
+    scale = mouse_accel_scale(&mouse_stick_accel,
+        (mouse_move.x != 0.0f || mouse_move.y != 0.0f), current_ticks);
+
+    mouse_move.x *= scale;
+    mouse_move.y *= scale;
+
+    if (current_dpad_as_mouse)
+    {
+        vector2d dpad_move;
+
+        vector2d_clear(&dpad_move);
+
+        dpad_move.x -= (is_pressed(GBTN_DPAD_LEFT ) ? 1.0f : 0.0f);
+        dpad_move.x += (is_pressed(GBTN_DPAD_RIGHT) ? 1.0f : 0.0f);
+        dpad_move.y -= (is_pressed(GBTN_DPAD_UP   ) ? 1.0f : 0.0f);
+        dpad_move.y += (is_pressed(GBTN_DPAD_DOWN ) ? 1.0f : 0.0f);
+
+        if (current_state.dpad_mouse_normalize)
+            vector2d_normalize(&dpad_move);
+
+        scale = mouse_accel_scale(&mouse_dpad_accel,
+            (dpad_move.x != 0.0f || dpad_move.y != 0.0f), current_ticks) * (float)(current_state.dpad_mouse_step);
+
+        mouse_move.x += dpad_move.x * scale;
+        mouse_move.y += dpad_move.y * scale;
+    }
+
+    vector2d scroll_move;
+
+    vector2d_set_float2(&scroll_move,
+        current_state.scroll_x[0] + current_state.scroll_x[1],
+        current_state.scroll_y[0] + current_state.scroll_y[1]);
+
+    if (current_dpad_mode == MOUSE_MOVEMENT_SCROLL)
+    {
+        scroll_move.x -= (is_pressed(GBTN_DPAD_LEFT ) ? 1.0f : 0.0f);
+        scroll_move.x += (is_pressed(GBTN_DPAD_RIGHT) ? 1.0f : 0.0f);
+        scroll_move.y -= (is_pressed(GBTN_DPAD_UP   ) ? 1.0f : 0.0f);
+        scroll_move.y += (is_pressed(GBTN_DPAD_DOWN ) ? 1.0f : 0.0f);
+    }
+
+    // pushing up scrolls up, which is a positive wheel value.
+    mouse_wheel_remainder  -= scroll_move.y * mouse_scroll_scale * dt;
+    mouse_hwheel_remainder += scroll_move.x * mouse_scroll_scale * dt;
+
+    if (current_state.mouse_slow)
+    {
+        mouse_move.x /= mouse_slow_scale;
+        mouse_move.y /= mouse_slow_scale;
+    }
+
+    float ticks = (dt * 1000.0f) / (float)(MOUSE_REFERENCE_DELAY);
+
+    mouse_remainder_x += mouse_move.x * ticks;
+    mouse_remainder_y += mouse_move.y * ticks;
+
+    // the gyro is already in pixels.
+    gyro_update();
+    gyro_take(&mouse_remainder_x, &mouse_remainder_y);
+    touchpad_take(&mouse_remainder_x, &mouse_remainder_y, dt);
+    flick_take(&mouse_remainder_x, now_us);
+    pointer_update(dt);
+    touchpad_take_scroll(&mouse_wheel_remainder, &mouse_hwheel_remainder);
+
+    int mouse_x = (int)(mouse_remainder_x);
+    int mouse_y = (int)(mouse_remainder_y);
+
+    mouse_remainder_x -= (float)(mouse_x);
+    mouse_remainder_y -= (float)(mouse_y);
+
+    // if (mouse_x != 0 || mouse_y != 0)
+    //     GPTK2_DEBUG("mouse move %d %d\n", mouse_x, mouse_y);
+
+    int wheel_hi_res = (int)(mouse_wheel_remainder);
+    int hwheel_hi_res = (int)(mouse_hwheel_remainder);
+
+    mouse_wheel_remainder -= (float)(wheel_hi_res);
+    mouse_hwheel_remainder -= (float)(hwheel_hi_res);
+
+    // old style wheel events only go out once a whole click has built up.
+    mouse_wheel_detent += wheel_hi_res;
+    mouse_hwheel_detent += hwheel_hi_res;
+
+    int mouse_wheel = mouse_wheel_detent / MOUSE_WHEEL_DETENT;
+    int mouse_hwheel = mouse_hwheel_detent / MOUSE_WHEEL_DETENT;
+
+    mouse_wheel_detent -= mouse_wheel * MOUSE_WHEEL_DETENT;
+    mouse_hwheel_detent -= mouse_hwheel * MOUSE_WHEEL_DETENT;
+
+    emitMouseReport(mouse_x, mouse_y, mouse_wheel, mouse_hwheel, wheel_hi_res, hwheel_hi_res);
+}
@@ -0,0 +1,697 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+#ifdef GPTK2_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+/* Output sinks.
+ *
+ * Finished frames from emit() end up here and are handed to the sink picked
+ * with output_sink. uinput is the real device, the others let the whole
+ * mapping run without /dev/uinput or root:
+ *
+ *  - null    throws everything away.
+ *  - memory  keeps the last OUTPUT_MEMORY_EVENTS events and a hash of the
+ *            whole stream, so two runs can be compared.
+ *  - file    writes timestamped struct input_event records to output_file,
+ *            the same format as reading /dev/input/eventX.
+ *
+ * Every frame belongs to one device, the keyboard / mouse (or pad in -x mode)
+ * is OUTPUT_DEVICE_MAIN and extra devices like the hybrid mode pad and the
+ * absolute pointer get their own. uinput writes each device to its own fd,
+ * memory tags its events with the device and file gives each extra device
+ * its own file.
+ *
+ * The uinput sink has two engines. write does one write() per frame. io_uring
+ * queues each frame as a write on a registered copy of the device's fd,
+ * linked to the one before, and output_submit() sends the whole lot with one
+ * syscall before the main loop goes to sleep. A link can't reach back into an
+ * earlier submit, so output_submit() waits for the last lot to finish before
+ * sending the next, that keeps every frame in order, even across devices.
+ * By then the last lot has normally long finished, so it rarely waits.
+ */
+
+typedef struct
+{
+    const char *name;
+    bool (*open)();
+    void (*write)(int device, const struct input_event *events, int count);
+    void (*submit)();
+    void (*close)();
+} output_sink_funcs;
+
+char output_file[OUTPUT_FILE_MAX] = "";
+
+static int output_fds[OUTPUT_DEVICE_MAX] = {-1, -1, -1};
+static int output_engine = OUTPUT_ENGINE_WRITE;
+static const output_sink_funcs *output_current = NULL;
+
+static Uint32 output_frames = 0;
+static Uint32 output_events = 0;
+
+#ifdef GPTK2_HAVE_IO_URING
+#define OUTPUT_RING_FRAMES 32
+
+static struct io_uring output_ring;
+static int output_ring_file[OUTPUT_DEVICE_MAX];
+static struct input_event output_ring_frames[OUTPUT_RING_FRAMES][OUTPUT_FRAME_MAX];
+static bool output_ring_busy[OUTPUT_RING_FRAMES];
+static int output_ring_next = 0;
+static int output_in_flight = 0;
+static int output_queued = 0;
+static struct io_uring_sqe *output_last_sqe = NULL;
+static bool output_error_shown = false;
+#endif
+
+#define OUTPUT_MEMORY_EVENTS 4096
+#define OUTPUT_MEMORY_SHOW 16
+
+typedef struct
+{
+    int device;
+    struct input_event event;
+} output_memory_event;
+
+static output_memory_event output_memory[OUTPUT_MEMORY_EVENTS];
+static Uint32 output_memory_next = 0;
+static Uint32 output_memory_hash = 0;
+
+static FILE *output_record[OUTPUT_DEVICE_MAX] = {NULL, NULL, NULL};
+
+
+int output_get_engine(const char *str)
+{
+    if (strcasecmp(str, "io_uring") == 0 || strcasecmp(str, "uring") == 0)
+        return OUTPUT_ENGINE_IO_URING;
+
+    // default
+    return OUTPUT_ENGINE_WRITE;
+}
+
+
+const char *output_engine_str(int engine)
+{
+    switch(engine)
+    {
+    default:
+    case OUTPUT_ENGINE_WRITE:
+        return "write";
+
+    case OUTPUT_ENGINE_IO_URING:
+        return "io_uring";
+    }
+}
+
+
+int output_get_sink(const char *str)
+{
+    if (strcasecmp(str, "null") == 0 || strcasecmp(str, "none") == 0)
+        return OUTPUT_SINK_NULL;
+
+    if (strcasecmp(str, "memory") == 0)
+        return OUTPUT_SINK_MEMORY;
+
+    if (strcasecmp(str, "file") == 0)
+        return OUTPUT_SINK_FILE;
+
+    // default
+    return OUTPUT_SINK_UINPUT;
+}
+
+
+const char *output_device_str(int device)
+{
+    switch(device)
+    {
+    default:
+    case OUTPUT_DEVICE_MAIN:
+        return "main";
+
+    case OUTPUT_DEVICE_PAD:
+        return "pad";
+
+    case OUTPUT_DEVICE_POINTER:
+        return "pointer";
+    }
+}
+
+
+const char *output_sink_str(int sink)
+{
+    switch(sink)
+    {
+    default:
+    case OUTPUT_SINK_UINPUT:
+        return "uinput";
+
+    case OUTPUT_SINK_NULL:
+        return "null";
+
+    case OUTPUT_SINK_MEMORY:
+        return "memory";
+
+    case OUTPUT_SINK_FILE:
+        return "file";
+    }
+}
+
+
+// uinput
+#ifdef GPTK2_HAVE_IO_URING
+static bool output_reap_one(bool wait)
+{   // returns false if there was nothing to reap.
+    struct io_uring_cqe *cqe;
+
+    if (output_in_flight == 0)
+        return false;
+
+    if (io_uring_peek_cqe(&output_ring, &cqe) != 0)
+    {
+        if (!wait)
+            return false;
+
+        if (io_uring_wait_cqe(&output_ring, &cqe) != 0)
+            return false;
+    }
+
+    if (cqe->res < 0 && !output_error_shown)
+    {
+        fprintf(stderr, "io_uring write failed: %s\n", strerror(-cqe->res));
+        output_error_shown = true;
+    }
+
+    // completions can come back in any order, so free the buffer this one used.
+    int slot = (int)(uintptr_t)(io_uring_cqe_get_data(cqe));
+
+    output_ring_busy[slot] = false;
+
+    io_uring_cqe_seen(&output_ring, cqe);
+    output_in_flight--;
+    return true;
+}
+
+
+static void output_reap()
+{
+    while (output_reap_one(false))
+        ;
+}
+
+
+static void output_ring_submit()
+{
+    output_reap();
+
+    if (output_queued == 0)
+        return;
+
+    // the link only holds inside one submit, let the last one finish so the two can't overlap.
+    while (output_reap_one(true))
+        ;
+
+    io_uring_submit(&output_ring);
+
+    output_in_flight += output_queued;
+    output_queued = 0;
+    output_last_sqe = NULL;
+}
+
+
+static void output_ring_wait_all()
+{
+    output_ring_submit();
+
+    while (output_reap_one(true))
+        ;
+}
+#endif
+
+
+static bool output_uinput_open()
+{
+    output_engine = OUTPUT_ENGINE_WRITE;
+
+    if (current_state.output_engine != OUTPUT_ENGINE_IO_URING)
+        return true;
+
+#ifdef GPTK2_HAVE_IO_URING
+    int result = io_uring_queue_init(OUTPUT_RING_FRAMES, &output_ring, 0);
+
+    if (result < 0)
+    {
+        printf("io_uring unavailable (%s), using write\n", strerror(-result));
+        return true;
+    }
+
+    // only the devices that exist are registered, the rest fall back to write.
+    int files[OUTPUT_DEVICE_MAX];
+    int file_count = 0;
+
+    for (int device=0; device < OUTPUT_DEVICE_MAX; device++)
+    {
+        output_ring_file[device] = -1;
+
+        if (output_fds[device] < 0)
+            continue;
+
+        output_ring_file[device] = file_count;
+        files[file_count++] = output_fds[device];
+    }
+
+    result = io_uring_register_files(&output_ring, files, file_count);
+
+    if (result < 0)
+    {
+        printf("io_uring unable to register uinput (%s), using write\n", strerror(-result));
+        io_uring_queue_exit(&output_ring);
+        return true;
+    }
+
+    memset(output_ring_busy, 0, sizeof(output_ring_busy));
+    output_ring_next = 0;
+    output_in_flight = 0;
+    output_queued = 0;
+    output_last_sqe = NULL;
+    output_engine = OUTPUT_ENGINE_IO_URING;
+
+    printf("Using io_uring for output\n");
+#else
+    printf("io_uring support not built in, using write\n");
+#endif
+
+    return true;
+}
+
+
+static void output_uinput_write(int device, const struct input_event *events, int count)
+{
+    if (output_fds[device] < 0)
+        return;
+
+#ifdef GPTK2_HAVE_IO_URING
+    if (output_engine == OUTPUT_ENGINE_IO_URING && output_ring_file[device] >= 0)
+    {
+        int slot = output_ring_next;
+
+        if (output_ring_busy[slot])
+        {   // the next buffer is still queued or being written, push out what we have and wait for that one.
+            output_ring_submit();
+
+            while (output_ring_busy[slot] && output_reap_one(true))
+                ;
+        }
+
+        struct io_uring_sqe *sqe = (output_ring_busy[slot] ? NULL : io_uring_get_sqe(&output_ring));
+
+        if (sqe != NULL)
+        {
+            struct input_event *frame = output_ring_frames[slot];
+
+            memcpy(frame, events, sizeof(struct input_event) * count);
+
+            io_uring_prep_write(sqe, output_ring_file[device], frame, sizeof(struct input_event) * count, 0);
+            sqe->flags |= IOSQE_FIXED_FILE;
+            io_uring_sqe_set_data(sqe, (void *)(uintptr_t)(slot));
+
+            if (output_last_sqe != NULL)
+                output_last_sqe->flags |= IOSQE_IO_LINK;
+
+            output_ring_busy[slot] = true;
+            output_last_sqe = sqe;
+            output_ring_next = (output_ring_next + 1) % OUTPUT_RING_FRAMES;
+            output_queued++;
+            return;
+        }
+
+        // no sqe, make sure everything before this goes first.
+        output_ring_wait_all();
+    }
+    else if (output_engine == OUTPUT_ENGINE_IO_URING)
+    {   // same for a device that isn't registered.
+        output_ring_wait_all();
+    }
+#endif
+
+    write(output_fds[device], events, sizeof(struct input_event) * count);
+}
+
+
+static void output_uinput_submit()
+{
+#ifdef GPTK2_HAVE_IO_URING
+    if (output_engine == OUTPUT_ENGINE_IO_URING)
+        output_ring_submit();
+#endif
+}
+
+
+static void output_uinput_close()
+{
+#ifdef GPTK2_HAVE_IO_URING
+    if (output_engine == OUTPUT_ENGINE_IO_URING)
+    {
+        output_ring_wait_all();
+        io_uring_queue_exit(&output_ring);
+    }
+#endif
+
+    output_engine = OUTPUT_ENGINE_WRITE;
+}
+
+
+// null
+static bool output_null_open()
+{
+    return true;
+}
+
+
+static void output_null_write(int device, const struct input_event *events, int count)
+{
+    (void)device;
+    (void)events;
+    (void)count;
+}
+
+
+static void output_null_submit()
+{
+}
+
+
+static void output_null_close()
+{
+    printf("null sink: %u frames, %u events\n", output_frames, output_events);
+}
+
+
+// memory
+static bool output_memory_open()
+{
+    output_memory_next = 0;
+
+    // FNV-1a
+    output_memory_hash = 2166136261u;
+    return true;
+}
+
+
+static void output_memory_write(int device, const struct input_event *events, int count)
+{
+    for (int i=0; i < count; i++)
+    {
+        const struct input_event *ev = &events[i];
+        Uint32 values[4] = {(Uint32)device, ev->type, ev->code, (Uint32)ev->value};
+        output_memory_event *stored = &output_memory[output_memory_next % OUTPUT_MEMORY_EVENTS];
+
+        stored->device = device;
+        stored->event = *ev;
+        output_memory_next++;
+
+        for (int j=0; j < 4; j++)
+        {
+            for (int k=0; k < 4; k++)
+            {
+                output_memory_hash ^= (values[j] >> (k * 8)) & 0xff;
+                output_memory_hash *= 16777619u;
+            }
+        }
+    }
+}
+
+
+static void output_memory_close()
+{
+    printf("memory sink: %u frames, %u events, hash %08x\n",
+        output_frames, output_events, output_memory_hash);
+
+    // the tail end is usually what you want to look at.
+    Uint32 first = ((output_memory_next > OUTPUT_MEMORY_SHOW) ? (output_memory_next - OUTPUT_MEMORY_SHOW) : 0);
+
+    for (Uint32 i=first; i < output_memory_next; i++)
+    {
+        const output_memory_event *stored = &output_memory[i % OUTPUT_MEMORY_EVENTS];
+        const struct input_event *ev = &stored->event;
+
+        printf("  %u: %-7s %u %u %d\n", i, output_device_str(stored->device), ev->type, ev->code, ev->value);
+    }
+}
+
+
+// file
+static FILE *output_file_device_open(int device)
+{   // the main device uses output_file, the others get the device name on the end.
+    char file_name[OUTPUT_FILE_MAX + 16];
+
+    if (device == OUTPUT_DEVICE_MAIN)
+        snprintf(file_name, sizeof(file_name), "%s", output_file);
+    else
+        snprintf(file_name, sizeof(file_name), "%s.%s", output_file, output_device_str(device));
+
+    FILE *record = fopen(file_name, "wb");
+
+    if (record == NULL)
+    {
+        fprintf(stderr, "file sink: unable to open %s: %s\n", file_name, strerror(errno));
+        return NULL;
+    }
+
+    printf("Recording %s output to %s\n", output_device_str(device), file_name);
+    return record;
+}
+
+
+static bool output_file_open()
+{
+    if (strlen(output_file) == 0)
+    {
+        fprintf(stderr, "file sink: output_file not set\n");
+        return false;
+    }
+
+    output_record[OUTPUT_DEVICE_MAIN] = output_file_device_open(OUTPUT_DEVICE_MAIN);
+
+    return (output_record[OUTPUT_DEVICE_MAIN] != NULL);
+}
+
+
+static void output_file_write(int device, const struct input_event *events, int count)
+{
+    if (output_record[device] == NULL)
+    {   // extra devices are opened when they first send something.
+        output_record[device] = output_file_device_open(device);
+
+        if (output_record[device] == NULL)
+            return;
+    }
+
+    struct input_event frame[OUTPUT_FRAME_MAX];
+    Uint64 now_us = timer_now_us();
+
+    memcpy(frame, events, sizeof(struct input_event) * count);
+
+    for (int i=0; i < count; i++)
+    {
+        frame[i].time.tv_sec = (time_t)(now_us / 1000000);
+        frame[i].time.tv_usec = (suseconds_t)(now_us % 1000000);
+    }
+
+    fwrite(frame, sizeof(struct input_event), count, output_record[device]);
+}
+
+
+static void output_file_submit()
+{
+    for (int device=0; device < OUTPUT_DEVICE_MAX; device++)
+    {
+        if (output_record[device] != NULL)
+            fflush(output_record[device]);
+    }
+}
+
+
+static void output_file_close()
+{
+    for (int device=0; device < OUTPUT_DEVICE_MAX; device++)
+    {
+        if (output_record[device] == NULL)
+            continue;
+
+        fclose(output_record[device]);
+        output_record[device] = NULL;
+    }
+
+    printf("file sink: %u frames, %u events written to %s\n", output_frames, output_events, output_file);
+}
+
+
+static const output_sink_funcs output_sinks[] = {
+    [OUTPUT_SINK_UINPUT] = {"uinput", output_uinput_open, output_uinput_write, output_uinput_submit, output_uinput_close},
+    [OUTPUT_SINK_NULL]   = {"null",   output_null_open,   output_null_write,   output_null_submit,   output_null_close},
+    [OUTPUT_SINK_MEMORY] = {"memory", output_memory_open, output_memory_write, output_null_submit,   output_memory_close},
+    [OUTPUT_SINK_FILE]   = {"file",   output_file_open,   output_file_write,   output_file_submit,   output_file_close},
+};
+
+
+void output_device(int device, int fd)
+{   // call before output_init for any extra devices, fd is only used by the uinput sink.
+    output_fds[device] = fd;
+}
+
+
+void output_init(int fd)
+{   // call after the devices are created, fd is the main device and only used by the uinput sink.
+    output_fds[OUTPUT_DEVICE_MAIN] = fd;
+    output_frames = 0;
+    output_events = 0;
+    output_current = &output_sinks[current_state.output_sink];
+
+    if (!output_current->open())
+    {
+        printf("Unable to open %s sink, using null\n", output_current->name);
+        output_current = &output_sinks[OUTPUT_SINK_NULL];
+    }
+}
+
+
+void output_quit()
+{
+    if (output_current == NULL)
+        return;
+
+    output_current->close();
+    output_current = NULL;
+
+    for (int device=0; device < OUTPUT_DEVICE_MAX; device++)
+        output_fds[device] = -1;
+}
+
+
+void output_write_device(int device, const struct input_event *events, int count)
+{   // events is one whole frame, ending with SYN_REPORT.
+    if (output_current == NULL)
+        return;
+
+    output_frames++;
+    output_events += count;
+
+    output_current->write(device, events, count);
+}
+
+
+void output_write(const struct input_event *events, int count)
+{
+    output_write_device(OUTPUT_DEVICE_MAIN, events, count);
+}
+
+
+void output_submit()
+{   // call before sleeping, sends everything output_write() queued up.
+    if (output_current == NULL)
+        return;
+
+    output_current->submit();
+}
+
+
+static float output_benchmark_run(int frames, int batch)
+{   // returns us per frame, the events are zero movements that the kernel drops.
+    struct input_event events[2];
+
+    memset(events, 0, sizeof(events));
+    events[0].type = EV_REL;
+    events[0].code = REL_X;
+    events[0].value = 0;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    events[1].value = 0;
+
+    Uint64 start_us = timer_now_us();
+
+    for (int i=0; i < frames; i++)
+    {
+        output_write(events, 2);
+
+        if ((i % batch) == (batch - 1))
+            output_submit();
+    }
+
+    output_submit();
+
+    return (float)(timer_now_us() - start_us) / (float)(frames);
+}
+
+
+void output_benchmark()
+{   // times the current sink, and compares write with io_uring on uinput.
+    const int frames = 10000;
+
+    if (output_current == NULL)
+        return;
+
+    if (output_current != &output_sinks[OUTPUT_SINK_UINPUT])
+    {
+        printf("output benchmark: %-8s  %6.2f us per frame\n", output_current->name, output_benchmark_run(frames, 1));
+        return;
+    }
+
+    int engine = output_engine;
+
+    output_engine = OUTPUT_ENGINE_WRITE;
+    printf("output benchmark: write     %6.2f us per frame\n", output_benchmark_run(frames, 1));
+
+#ifdef GPTK2_HAVE_IO_URING
+    if (engine == OUTPUT_ENGINE_IO_URING)
+    {
+        output_engine = OUTPUT_ENGINE_IO_URING;
+        printf("output benchmark: io_uring  %6.2f us per frame (1 frame per submit)\n", output_benchmark_run(frames, 1));
+        printf("output benchmark: io_uring  %6.2f us per frame (8 frames per submit)\n", output_benchmark_run(frames, 8));
+
+        output_ring_wait_all();
+    }
+    else
+#endif
+    {
+        printf("output benchmark: io_uring not in use, set output_engine = io_uring to compare.\n");
+    }
+
+    output_engine = engine;
+}
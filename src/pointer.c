@@ -0,0 +1,243 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Absolute pointer.
+ *
+ * A stick set to absolute_mouse puts the cursor at a spot on the screen
+ * instead of moving it, the middle of the stick is the middle of the screen.
+ * This lives on its own uinput device with ABS_X / ABS_Y so the relative
+ * mouse on the keyboard device is left alone. Events are only sent when the
+ * cursor lands on a different pixel.
+ *
+ * Frames go through output.c as OUTPUT_DEVICE_POINTER, so the other sinks
+ * see the pointer too, they just don't get a device.
+ */
+
+static bool pointer_enabled = false;
+static int pointer_fd = -1;
+
+static float pointer_target_x = 0.0f;
+static float pointer_target_y = 0.0f;
+static float pointer_x = 0.0f;
+static float pointer_y = 0.0f;
+
+static int pointer_last_x = -1;
+static int pointer_last_y = -1;
+
+
+static bool pointer_config_used()
+{
+    for (gptokeyb_config *current = root_config; current != NULL; current = current->next)
+    {
+        if (current->left_analog_as_mouse == MOUSE_MOVEMENT_ABSOLUTE ||
+            current->right_analog_as_mouse == MOUSE_MOVEMENT_ABSOLUTE)
+            return true;
+    }
+
+    return false;
+}
+
+
+static void pointer_reset()
+{   // start in the middle, and count it as already sent so the mouse tick doesn't start up for nothing.
+    pointer_stick_update(0, 0);
+    pointer_x = pointer_target_x;
+    pointer_y = pointer_target_y;
+
+    pointer_last_x = (int)(pointer_x + 0.5f);
+    pointer_last_y = (int)(pointer_y + 0.5f);
+}
+
+
+void pointer_init()
+{   // call before output_init, only creates the device if a config actually uses absolute_mouse.
+    struct uinput_user_dev device;
+
+    if (!pointer_config_used())
+        return;
+
+    if (current_state.output_sink != OUTPUT_SINK_UINPUT)
+    {
+        pointer_enabled = true;
+        pointer_reset();
+        return;
+    }
+
+    pointer_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+
+    if (pointer_fd < 0)
+    {
+        printf("Unable to open /dev/uinput for the absolute pointer\n");
+        return;
+    }
+
+    memset(&device, 0, sizeof(device));
+    strncpy(device.name, "Fake Absolute Pointer", UINPUT_MAX_NAME_SIZE);
+    device.id.version = 1;
+    device.id.bustype = BUS_USB;
+    device.id.vendor = 0x1234;  /* sample vendor */
+    device.id.product = 0x5679; /* sample product */
+
+    device.absmin[ABS_X] = 0;
+    device.absmax[ABS_X] = current_state.absolute_width - 1;
+    device.absmin[ABS_Y] = 0;
+    device.absmax[ABS_Y] = current_state.absolute_height - 1;
+
+    ioctl(pointer_fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(pointer_fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(pointer_fd, UI_SET_ABSBIT, ABS_X);
+    ioctl(pointer_fd, UI_SET_ABSBIT, ABS_Y);
+
+    // a button is needed for udev to treat this as a mouse, the clicks still go through the keyboard device.
+    ioctl(pointer_fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(pointer_fd, UI_SET_KEYBIT, BTN_LEFT);
+    ioctl(pointer_fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+
+    if (uinput_create(pointer_fd, &device))
+    {
+        printf("Unable to create absolute pointer device.\n");
+        close(pointer_fd);
+        pointer_fd = -1;
+        return;
+    }
+
+    output_device(OUTPUT_DEVICE_POINTER, pointer_fd);
+    pointer_enabled = true;
+    pointer_reset();
+}
+
+
+void pointer_quit()
+{   // call after output_quit.
+    pointer_enabled = false;
+
+    if (pointer_fd < 0)
+        return;
+
+    ioctl(pointer_fd, UI_DEV_DESTROY);
+    close(pointer_fd);
+    pointer_fd = -1;
+}
+
+
+void pointer_stick_update(int x, int y)
+{   // called from the axis events of a stick set to absolute_mouse.
+    float stick_x;
+    float stick_y;
+
+    deadzone_mouse_calc(&stick_x, &stick_y, x, y);
+
+    stick_x /= (float)(current_state.deadzone_scale);
+    stick_y /= (float)(current_state.deadzone_scale);
+
+    pointer_target_x = (stick_x + 1.0f) * 0.5f * (float)(current_state.absolute_width - 1);
+    pointer_target_y = (stick_y + 1.0f) * 0.5f * (float)(current_state.absolute_height - 1);
+}
+
+
+bool pointer_active()
+{   // true while the cursor is still gliding towards the stick position.
+    if (!pointer_enabled)
+        return false;
+
+    return ((int)(pointer_target_x + 0.5f) != pointer_last_x ||
+            (int)(pointer_target_y + 0.5f) != pointer_last_y);
+}
+
+
+void pointer_update(float dt)
+{
+    struct input_event events[3];
+    int count = 0;
+
+    if (!pointer_enabled)
+        return;
+
+    if (current_state.absolute_smoothing > 0)
+    {
+        float alpha = dt / (dt + ((float)(current_state.absolute_smoothing) / 1000.0f));
+
+        pointer_x += (pointer_target_x - pointer_x) * alpha;
+        pointer_y += (pointer_target_y - pointer_y) * alpha;
+
+        // close enough, snap so it settles.
+        if (fabsf(pointer_target_x - pointer_x) < 0.5f)
+            pointer_x = pointer_target_x;
+
+        if (fabsf(pointer_target_y - pointer_y) < 0.5f)
+            pointer_y = pointer_target_y;
+    }
+    else
+    {
+        pointer_x = pointer_target_x;
+        pointer_y = pointer_target_y;
+    }
+
+    int new_x = (int)(pointer_x + 0.5f);
+    int new_y = (int)(pointer_y + 0.5f);
+
+    if (new_x == pointer_last_x && new_y == pointer_last_y)
+        return;
+
+    memset(events, 0, sizeof(events));
+
+    if (new_x != pointer_last_x)
+    {
+        events[count].type = EV_ABS;
+        events[count].code = ABS_X;
+        events[count++].value = new_x;
+    }
+
+    if (new_y != pointer_last_y)
+    {
+        events[count].type = EV_ABS;
+        events[count].code = ABS_Y;
+        events[count++].value = new_y;
+    }
+
+    events[count].type = EV_SYN;
+    events[count].code = SYN_REPORT;
+    events[count++].value = 0;
+
+    output_write_device(OUTPUT_DEVICE_POINTER, events, count);
+
+    pointer_last_x = new_x;
+    pointer_last_y = new_y;
+}
@@ -0,0 +1,298 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+#include <poll.h>
+
+/* Rumble passthrough.
+ *
+ * The fake pad says it can do FF_RUMBLE. When a game uploads an effect the
+ * kernel asks us for it through the uinput fd and the game waits until we
+ * answer, so a thread sits in poll() on the fd and answers straight away.
+ * It keeps the effects, and when one is played it pushes an SDL user event,
+ * which wakes up the main loop to call SDL_GameControllerRumble() on the real
+ * controller. Nothing on the input side ever waits for any of this.
+ */
+
+static int rumble_fd = -1;
+static int rumble_wake[2] = {-1, -1};
+static SDL_Thread *rumble_thread = NULL;
+static Uint32 rumble_event_type = (Uint32)(-1);
+
+static SDL_GameController *rumble_controller = NULL;
+
+// only touched by the thread.
+typedef struct
+{
+    bool used;
+    Uint16 strong;
+    Uint16 weak;
+    Uint16 length;
+} rumble_effect;
+
+static rumble_effect rumble_effects[XBOX_FF_EFFECTS];
+
+
+static void rumble_push(Uint16 strong, Uint16 weak, Uint32 length)
+{
+    SDL_Event event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = rumble_event_type;
+    event.user.code = (Sint32)(length);
+    event.user.data1 = (void *)(uintptr_t)(strong);
+    event.user.data2 = (void *)(uintptr_t)(weak);
+
+    SDL_PushEvent(&event);
+}
+
+
+static void rumble_upload(int request_id)
+{
+    struct uinput_ff_upload upload;
+
+    memset(&upload, 0, sizeof(upload));
+    upload.request_id = request_id;
+
+    if (ioctl(rumble_fd, UI_BEGIN_FF_UPLOAD, &upload) < 0)
+        return;
+
+    int id = upload.effect.id;
+
+    if (upload.effect.type != FF_RUMBLE || id < 0 || id >= XBOX_FF_EFFECTS)
+    {
+        upload.retval = -EINVAL;
+    }
+    else
+    {
+        rumble_effects[id].used = true;
+        rumble_effects[id].strong = upload.effect.u.rumble.strong_magnitude;
+        rumble_effects[id].weak = upload.effect.u.rumble.weak_magnitude;
+        rumble_effects[id].length = upload.effect.replay.length;
+        upload.retval = 0;
+
+        GPTK2_DEBUG("rumble: upload %d strong %u weak %u length %u\n",
+            id, rumble_effects[id].strong, rumble_effects[id].weak, rumble_effects[id].length);
+    }
+
+    ioctl(rumble_fd, UI_END_FF_UPLOAD, &upload);
+}
+
+
+static void rumble_erase(int request_id)
+{
+    struct uinput_ff_erase erase;
+
+    memset(&erase, 0, sizeof(erase));
+    erase.request_id = request_id;
+
+    if (ioctl(rumble_fd, UI_BEGIN_FF_ERASE, &erase) < 0)
+        return;
+
+    if (erase.effect_id < XBOX_FF_EFFECTS)
+        rumble_effects[erase.effect_id].used = false;
+
+    GPTK2_DEBUG("rumble: erase %u\n", erase.effect_id);
+
+    erase.retval = 0;
+    ioctl(rumble_fd, UI_END_FF_ERASE, &erase);
+}
+
+
+static void rumble_play(int id, int count)
+{
+    if (id < 0 || id >= XBOX_FF_EFFECTS || !rumble_effects[id].used)
+        return;
+
+    if (count == 0)
+    {   // stop
+        rumble_push(0, 0, 0);
+        return;
+    }
+
+    // length 0 is "until stopped", as long as SDL lets us.
+    Uint32 length = rumble_effects[id].length;
+
+    if (length == 0)
+        length = 0xFFFF;
+
+    rumble_push(rumble_effects[id].strong, rumble_effects[id].weak, length);
+}
+
+
+static int rumble_thread_main(void *data)
+{
+    struct pollfd fds[2];
+    struct input_event ev;
+
+    (void)data;
+
+    fds[0].fd = rumble_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = rumble_wake[0];
+    fds[1].events = POLLIN;
+
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        // rumble_quit()
+        if (fds[1].revents != 0)
+            break;
+
+        while (read(rumble_fd, &ev, sizeof(ev)) == sizeof(ev))
+        {
+            if (ev.type == EV_UINPUT && ev.code == UI_FF_UPLOAD)
+                rumble_upload(ev.value);
+
+            else if (ev.type == EV_UINPUT && ev.code == UI_FF_ERASE)
+                rumble_erase(ev.value);
+
+            else if (ev.type == EV_FF)
+                rumble_play(ev.code, ev.value);
+        }
+    }
+
+    return 0;
+}
+
+
+void setupFakeXbox360Rumble(struct uinput_user_dev *device, int fd)
+{   // call before the device is created.
+    if (ioctl(fd, UI_SET_EVBIT, EV_FF) || ioctl(fd, UI_SET_FFBIT, FF_RUMBLE))
+    {
+        printf("rumble: unable to set up force feedback\n");
+        return;
+    }
+
+    device->ff_effects_max = XBOX_FF_EFFECTS;
+}
+
+
+void rumble_init(int fd)
+{   // call after the device is created, fd needs to be opened O_RDWR.
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+    rumble_fd = fd;
+    memset(rumble_effects, 0, sizeof(rumble_effects));
+
+    rumble_event_type = SDL_RegisterEvents(1);
+
+    if (rumble_event_type == (Uint32)(-1))
+    {
+        printf("rumble: unable to register event\n");
+        return;
+    }
+
+    if (pipe(rumble_wake) != 0)
+    {
+        printf("rumble: unable to create pipe: %s\n", strerror(errno));
+        return;
+    }
+
+    rumble_thread = SDL_CreateThread(rumble_thread_main, "rumble", NULL);
+
+    if (rumble_thread == NULL)
+    {
+        printf("rumble: unable to create thread: %s\n", SDL_GetError());
+        close(rumble_wake[0]);
+        close(rumble_wake[1]);
+        rumble_wake[0] = rumble_wake[1] = -1;
+    }
+#else
+    printf("rumble: needs SDL 2.0.9 or newer\n");
+#endif
+}
+
+
+void rumble_quit()
+{   // call before the device is destroyed.
+    if (rumble_thread != NULL)
+    {
+        write(rumble_wake[1], "q", 1);
+        SDL_WaitThread(rumble_thread, NULL);
+        rumble_thread = NULL;
+
+        close(rumble_wake[0]);
+        close(rumble_wake[1]);
+        rumble_wake[0] = rumble_wake[1] = -1;
+    }
+
+    rumble_fd = -1;
+}
+
+
+void rumble_controller_added(SDL_GameController *controller)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+    rumble_controller = controller;
+#endif
+}
+
+
+void rumble_controller_removed(SDL_GameController *controller)
+{
+    if (rumble_controller == controller)
+        rumble_controller = NULL;
+}
+
+
+bool rumble_event(const SDL_Event *event)
+{   // returns true if it was a rumble event.
+    if (rumble_thread == NULL || event->type != rumble_event_type)
+        return false;
+
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+    if (rumble_controller != NULL)
+    {
+        Uint16 strong = (Uint16)(uintptr_t)(event->user.data1);
+        Uint16 weak = (Uint16)(uintptr_t)(event->user.data2);
+
+        GPTK2_DEBUG("rumble: strong %u weak %u for %d ms\n", strong, weak, event->user.code);
+        SDL_GameControllerRumble(rumble_controller, strong, weak, (Uint32)(event->user.code));
+    }
+#endif
+
+    return true;
+}
@@ -42,6 +42,15 @@ bool current_dpad_as_mouse = false;
 bool current_left_analog_as_mouse = false;
 bool current_right_analog_as_mouse = false;
 
+int current_dpad_mode = MOUSE_MOVEMENT_OFF;
+int current_left_analog_mode = MOUSE_MOVEMENT_OFF;
+int current_right_analog_mode = MOUSE_MOVEMENT_OFF;
+
+bool current_left_analog_pwm = false;
+bool current_right_analog_pwm = false;
+
+static void pwm_update(Uint64 now_us);
+
 
 void state_init()
 {
@@ -53,18 +62,85 @@ void state_init()
 
     current_state.repeat_delay = SDL_DEFAULT_REPEAT_DELAY;
     current_state.repeat_rate = SDL_DEFAULT_REPEAT_INTERVAL;
+    current_state.kernel_repeat = false;
+
+    current_state.output_sink = OUTPUT_SINK_UINPUT;
+    current_state.output_engine = OUTPUT_ENGINE_WRITE;
+    current_state.output_benchmark = false;
 
+    current_state.mouse_delay = MOUSE_REFERENCE_DELAY;
     current_state.dpad_mouse_step = 5;
     current_state.mouse_slow_scale = 50;
 
+    current_state.mouse_accel = MOUSE_ACCEL_CONSTANT;
+    current_state.mouse_accel_delay = 250;
+    current_state.mouse_accel_time = 500;
+    current_state.mouse_accel_max = 300;
+
+    current_state.dpad_mouse_accel = MOUSE_ACCEL_CONSTANT;
+    current_state.dpad_mouse_accel_delay = 250;
+    current_state.dpad_mouse_accel_time = 500;
+    current_state.dpad_mouse_accel_max = 300;
+
     current_state.deadzone_mode = DZ_DEFAULT;
     current_state.deadzone_scale = 512;
 
     current_state.deadzone_x = 1000;
     current_state.deadzone_y = 1000;
     current_state.deadzone_triggers = 3000;
+    current_state.trigger_full = 30000;
+    current_state.trigger_hysteresis = 1000;
+
+    current_state.xbox_left_deadzone = 0;
+    current_state.xbox_right_deadzone = 0;
+    current_state.xbox_anti_deadzone = 0;
+    current_state.xbox_curve = 100;
+    current_state.xbox_trigger_deadzone = 0;
+    current_state.xbox_trigger_max = 32767;
+
+    current_state.gyro_mouse = false;
+    current_state.gyro_scale = 800;
+    current_state.gyro_smoothing = 10;
+    current_state.gyro_calibrate_time = 1000;
+
+    current_state.touchpad_mouse = false;
+    current_state.touchpad_scale = 1000;
+    current_state.touchpad_accel = 50;
+    current_state.touchpad_scroll_scale = 10;
+
+    current_state.deadzone_calibrate = false;
+    current_state.deadzone_calibrate_time = 500;
 
     current_state.dpad_mouse_normalize = true;
+
+    current_state.flick_turn = 3600;
+    current_state.flick_time = 100;
+    current_state.flick_threshold = 29000;
+    current_state.flick_tick = 2;
+
+    current_state.scroll_speed = 10;
+
+    current_state.absolute_width = 1280;
+    current_state.absolute_height = 720;
+    current_state.absolute_smoothing = 0;
+
+    current_state.pwm_period = 50;
+
+    current_state.debounce_time = 0;
+
+    current_state.left_analog_mouse_scale = 100;
+    current_state.right_analog_mouse_scale = 100;
+
+    current_state.radial_menu = NULL;
+    current_state.radial_menu_btn = GBTN_NONE;
+    current_state.radial_selected = -1;
+
+    current_state.analog_directions = ANALOG_DIR_AXIAL;
+    current_state.analog_hysteresis = 300;
+    current_state.analog_angle_hysteresis = 4;
+
+    current_state.left_analog_sector = -1;
+    current_state.right_analog_sector = -1;
 }
 
 
@@ -226,11 +302,57 @@ void state_update()
         current_state.next_repeat[btn] = (current_ticks + current_state.repeat_rate);
     }
 
-    if (!current_left_analog_as_mouse && !current_right_analog_as_mouse)
+    if (current_state.in_pwm != 0)
+        pwm_update(timer_now_us());
+
+    debounce_update();
+    calibrate_update();
+
+    if (!current_left_analog_as_mouse)
+    {
+        current_state.analog_mouse_x[0] = 0;
+        current_state.analog_mouse_y[0] = 0;
+    }
+
+    if (!current_right_analog_as_mouse)
     {
-        current_state.mouse_x = 0;
-        current_state.mouse_x = 0;
+        current_state.analog_mouse_x[1] = 0;
+        current_state.analog_mouse_y[1] = 0;
     }
+
+    if (current_left_analog_mode != MOUSE_MOVEMENT_SCROLL)
+    {
+        current_state.scroll_x[0] = 0;
+        current_state.scroll_y[0] = 0;
+    }
+
+    if (current_right_analog_mode != MOUSE_MOVEMENT_SCROLL)
+    {
+        current_state.scroll_x[1] = 0;
+        current_state.scroll_y[1] = 0;
+    }
+}
+
+
+static bool stick_uses_pwm(int gbtn_up)
+{
+    bool uses_pwm = false;
+
+    for (int i=0; i < 4; i++)
+    {
+        const gptokeyb_button *button = state_button(gbtn_up + i);
+
+        if (button != NULL && button->pwm)
+            uses_pwm = true;
+    }
+
+    if (!uses_pwm)
+    {   // so it doesn't start with a stale duty if it comes back.
+        for (int i=0; i < 4; i++)
+            current_state.pwm_duty[gbtn_up + i] = 0;
+    }
+
+    return uses_pwm;
 }
 
 
@@ -263,18 +385,21 @@ void state_change_update()
             if (!found_dpad_as_mouse && current->dpad_as_mouse != MOUSE_MOVEMENT_PARENT)
             {
                 current_dpad_as_mouse = (current->dpad_as_mouse == MOUSE_MOVEMENT_ON);
+                current_dpad_mode = current->dpad_as_mouse;
                 found_dpad_as_mouse = true;
             }
 
             if (!found_left_analog_as_mouse && current->left_analog_as_mouse != MOUSE_MOVEMENT_PARENT)
             {
                 current_left_analog_as_mouse = (current->left_analog_as_mouse == MOUSE_MOVEMENT_ON);
+                current_left_analog_mode = current->left_analog_as_mouse;
                 found_left_analog_as_mouse = true;
             }
 
             if (!found_right_analog_as_mouse && current->right_analog_as_mouse != MOUSE_MOVEMENT_PARENT)
             {
                 current_right_analog_as_mouse = (current->right_analog_as_mouse == MOUSE_MOVEMENT_ON);
+                current_right_analog_mode = current->right_analog_as_mouse;
                 found_right_analog_as_mouse = true;
             }
         }
@@ -291,18 +416,21 @@ void state_change_update()
         if (!found_dpad_as_mouse && current->dpad_as_mouse != MOUSE_MOVEMENT_PARENT)
         {
             current_dpad_as_mouse = (current->dpad_as_mouse == MOUSE_MOVEMENT_ON);
+            current_dpad_mode = current->dpad_as_mouse;
             found_dpad_as_mouse = true;
         }
 
         if (!found_left_analog_as_mouse && current->left_analog_as_mouse != MOUSE_MOVEMENT_PARENT)
         {
             current_left_analog_as_mouse = (current->left_analog_as_mouse == MOUSE_MOVEMENT_ON);
+            current_left_analog_mode = current->left_analog_as_mouse;
             found_left_analog_as_mouse = true;
         }
 
         if (!found_right_analog_as_mouse && current->right_analog_as_mouse != MOUSE_MOVEMENT_PARENT)
         {
             current_right_analog_as_mouse = (current->right_analog_as_mouse == MOUSE_MOVEMENT_ON);
+            current_right_analog_mode = current->right_analog_as_mouse;
             found_right_analog_as_mouse = true;
         }
 
@@ -310,13 +438,28 @@ void state_change_update()
     }
 
     if (!found_dpad_as_mouse)
+    {
         current_dpad_as_mouse = false;
+        current_dpad_mode = MOUSE_MOVEMENT_OFF;
+    }
 
     if (!found_left_analog_as_mouse)
+    {
         current_left_analog_as_mouse = false;
+        current_left_analog_mode = MOUSE_MOVEMENT_OFF;
+    }
 
     if (!found_right_analog_as_mouse)
+    {
         current_right_analog_as_mouse = false;
+        current_right_analog_mode = MOUSE_MOVEMENT_OFF;
+    }
+
+    // the stick only works out pwm duty if one of its directions uses it.
+    current_left_analog_pwm = stick_uses_pwm(GBTN_LEFT_ANALOG_UP);
+    current_right_analog_pwm = stick_uses_pwm(GBTN_RIGHT_ANALOG_UP);
+
+    hybrid_update_routes();
 }
 
 
@@ -371,6 +514,289 @@ const gptokeyb_button *state_button(int btn)
 }
 
 
+/* Analog PWM.
+ *
+ * A stick direction bound with pwm holds its key for part of every
+ * pwm_period, the further the stick is pushed the longer the key is held.
+ * Each button keeps the time its next edge is due, state_update() handles the
+ * ones that are due and the main loop sleeps until state_next_deadline().
+ */
+
+static void pwm_set_output(int btn, const gptokeyb_button *button, bool on)
+{   // only the edges go out.
+    Uint32 btn_mask = (1<<btn);
+
+    if (((current_state.pwm_output & btn_mask) != 0) == on)
+        return;
+
+    if (on)
+        current_state.pwm_output |=  btn_mask;
+    else
+        current_state.pwm_output &= ~btn_mask;
+
+    if (button->keycode != 0)
+        emitKey(button->keycode, on, button->modifier);
+}
+
+
+static void pwm_start_cycle(int btn, const gptokeyb_button *button, Uint64 start_us)
+{
+    Uint64 period_us = (Uint64)(current_state.pwm_period) * 1000;
+    Uint64 on_us = (period_us * (Uint64)(current_state.pwm_duty[btn])) / PWM_DUTY_MAX;
+
+    current_state.pwm_cycle_us[btn] = start_us;
+
+    if (on_us == 0)
+    {
+        pwm_set_output(btn, button, false);
+        current_state.pwm_next_us[btn] = start_us + period_us;
+    }
+    else if (on_us >= period_us)
+    {
+        pwm_set_output(btn, button, true);
+        current_state.pwm_next_us[btn] = start_us + period_us;
+    }
+    else
+    {
+        pwm_set_output(btn, button, true);
+        current_state.pwm_next_us[btn] = start_us + on_us;
+    }
+}
+
+
+static void pwm_update(Uint64 now_us)
+{
+    Uint64 period_us = (Uint64)(current_state.pwm_period) * 1000;
+
+    for (int btn=0; btn < GBTN_MAX; btn++)
+    {
+        if ((current_state.in_pwm & (1<<btn)) == 0)
+            continue;
+
+        if (now_us < current_state.pwm_next_us[btn])
+            continue;
+
+        const gptokeyb_button *button = state_button(btn);
+
+        if (button == NULL)
+            continue;
+
+        Uint64 cycle_end_us = current_state.pwm_cycle_us[btn] + period_us;
+
+        if (now_us < cycle_end_us)
+        {   // end of the on part of the cycle.
+            pwm_set_output(btn, button, false);
+            current_state.pwm_next_us[btn] = cycle_end_us;
+            continue;
+        }
+
+        // start again from now if we fell a whole period behind.
+        if ((now_us - cycle_end_us) >= period_us)
+            cycle_end_us = now_us;
+
+        pwm_start_cycle(btn, button, cycle_end_us);
+    }
+}
+
+
+Uint64 state_next_deadline()
+{   // when the next pwm edge, debounce window or calibration sample is due, 0 if there isn't one.
+    Uint64 deadline_us = debounce_next_deadline();
+    Uint64 calibrate_us = calibrate_next_deadline();
+
+    if (calibrate_us != 0 && (deadline_us == 0 || calibrate_us < deadline_us))
+        deadline_us = calibrate_us;
+
+    for (int btn=0; btn < GBTN_MAX; btn++)
+    {
+        if ((current_state.in_pwm & (1<<btn)) == 0)
+            continue;
+
+        if (deadline_us == 0 || current_state.pwm_next_us[btn] < deadline_us)
+            deadline_us = current_state.pwm_next_us[btn];
+    }
+
+    return deadline_us;
+}
+
+
+/* Zones.
+ *
+ * A stick direction can have extra zones further out, each with its own set
+ * of keys. Level 0 is the normal binding, level n is zones[n-1]. Moving
+ * between levels only presses and releases the keys that differ, so going
+ * from "w" to "w shift" just presses shift.
+ */
+
+static int zone_keys(const gptokeyb_button *button, int level, short *keycodes)
+{
+    if (level == 0)
+    {
+        if (button->keycode == 0)
+            return 0;
+
+        keycodes[0] = button->keycode;
+        return 1;
+    }
+
+    const gptokeyb_zone *zone = &button->zones[level-1];
+
+    memcpy(keycodes, zone->keycodes, sizeof(short) * zone->key_count);
+    return zone->key_count;
+}
+
+
+static bool zone_has_key(const short *keycodes, int count, short keycode)
+{
+    for (int i=0; i < count; i++)
+    {
+        if (keycodes[i] == keycode)
+            return true;
+    }
+
+    return false;
+}
+
+
+static void zone_set_level(int btn, const gptokeyb_button *button, int level)
+{
+    short old_keys[ZONE_KEYS_MAX];
+    short new_keys[ZONE_KEYS_MAX];
+    int old_count = zone_keys(button, current_state.zone_level[btn], old_keys);
+    int new_count = zone_keys(button, level, new_keys);
+
+    // the base key keeps its modifiers, the zone keys are sent as is.
+    for (int i=0; i < old_count; i++)
+    {
+        if (!zone_has_key(new_keys, new_count, old_keys[i]))
+            emitKey(old_keys[i], false, ((old_keys[i] == button->keycode) ? button->modifier : 0));
+    }
+
+    for (int i=0; i < new_count; i++)
+    {
+        if (!zone_has_key(old_keys, old_count, new_keys[i]))
+            emitKey(new_keys[i], true, ((new_keys[i] == button->keycode) ? button->modifier : 0));
+    }
+
+    current_state.zone_level[btn] = (Uint8)(level);
+}
+
+
+static void zone_release(int btn, const gptokeyb_button *button)
+{
+    short keycodes[ZONE_KEYS_MAX];
+    int count = zone_keys(button, current_state.zone_level[btn], keycodes);
+
+    for (int i=0; i < count; i++)
+        emitKey(keycodes[i], false, ((keycodes[i] == button->keycode) ? button->modifier : 0));
+
+    current_state.zone_level[btn] = 0;
+}
+
+
+void update_button_zone(int btn, Sint64 magnitude_sq)
+{   // called after the direction buttons are updated, magnitude_sq is x*x + y*y of the stick.
+    if (!is_pressed(btn))
+        return;
+
+    const gptokeyb_button *button = state_button(btn);
+
+    if (button == NULL || button->zone_count == 0 || button->pwm)
+        return;
+
+    int level = current_state.zone_level[btn];
+
+    while (level < button->zone_count)
+    {
+        Sint64 enter = button->zones[level].threshold;
+
+        if (magnitude_sq < (enter * enter))
+            break;
+
+        level++;
+    }
+
+    while (level > 0)
+    {   // a big analog_hysteresis would put the exit at or below 0 and the zone would never let go.
+        Sint64 enter = button->zones[level-1].threshold;
+        Sint64 exit = enter - current_state.analog_hysteresis;
+
+        if (exit < (enter / 2))
+            exit = enter / 2;
+
+        if (magnitude_sq >= (exit * exit))
+            break;
+
+        level--;
+    }
+
+    if (level != current_state.zone_level[btn])
+        zone_set_level(btn, button, level);
+}
+
+
+/* Radial menu.
+ *
+ * While a radial_menu button is held its stick picks one of the keys, up is
+ * the first one and they go round clockwise. Letting go of the button taps
+ * the key that was picked. Nothing is looked up unless a menu is open.
+ */
+
+static void radial_menu_open(int btn, const gptokeyb_button *button)
+{
+    int gbtn_up = ((button->radial_stick == 0) ? GBTN_LEFT_ANALOG_UP : GBTN_RIGHT_ANALOG_UP);
+
+    // let go of anything the stick was holding, it belongs to the menu now.
+    for (int i=0; i < 4; i++)
+    {
+        if (is_pressed(gbtn_up + i))
+            update_button(gbtn_up + i, false);
+    }
+
+    current_state.analog_mouse_x[button->radial_stick] = 0;
+    current_state.analog_mouse_y[button->radial_stick] = 0;
+
+    // same for scrolling and flicking, the stick's axis events stop coming while the menu is open.
+    current_state.scroll_x[button->radial_stick] = 0;
+    current_state.scroll_y[button->radial_stick] = 0;
+
+    flick_stick_reset(button->radial_stick);
+
+    current_state.radial_menu = button;
+    current_state.radial_menu_btn = btn;
+    current_state.radial_selected = -1;
+}
+
+
+static void radial_menu_close()
+{
+    const gptokeyb_button *button = current_state.radial_menu;
+    int btn = current_state.radial_menu_btn;
+
+    current_state.radial_menu = NULL;
+    current_state.radial_menu_btn = GBTN_NONE;
+
+    if (current_state.radial_selected < 0)
+        return;
+
+    short keycode = button->radial_keys[current_state.radial_selected];
+
+    GPTK2_DEBUG("RADIAL '%s' -> '%s'\n", gbtn_names[btn], find_keycode(keycode));
+    emitKey(keycode, true, 0);
+    emitKey(keycode, false, 0);
+}
+
+
+void radial_menu_update(int x, int y)
+{   // called instead of the normal stick handling while a menu is open.
+    int sector = analog_radial_sector(x, y, current_state.radial_menu->radial_count);
+
+    // the last pick sticks when the stick goes back to the middle.
+    if (sector >= 0)
+        current_state.radial_selected = sector;
+}
+
+
 void update_button(int btn, bool pressed)
 {
     Uint32 btn_mask = (1<<btn);
@@ -417,20 +843,30 @@ void update_button(int btn, bool pressed)
                 push_state(button->cfg_map);
             }
         }
+        else if (button->action == ACT_RADIAL_MENU)
+        {
+            if (current_state.radial_menu == NULL)
+                radial_menu_open(btn, button);
+        }
         else if (button->action == ACT_MOUSE_SLOW)
         {   // this way we can always clear the mouse_slow flag if the state changes.
             current_state.mouse_slow |= btn_mask;
         }
-        else if (GBTN_IS_DPAD(btn) && current_dpad_as_mouse)
+        else if (GBTN_IS_DPAD(btn) && (current_dpad_as_mouse || current_dpad_mode == MOUSE_MOVEMENT_SCROLL))
         {   // this way we can always clear the mouse_move flag if the state changes.
             current_state.mouse_move |= btn_mask;
         }
-        else if (button->repeat && !(current_state.in_repeat & btn_mask))
+        else if (button->repeat && !current_state.kernel_repeat && !(current_state.in_repeat & btn_mask))
         {
             current_state.in_repeat |= btn_mask;
             current_state.next_repeat[btn] = (current_ticks + current_state.repeat_delay);
         }
-        if (button->keycode != 0)
+        if (button->pwm)
+        {
+            current_state.in_pwm |= btn_mask;
+            pwm_start_cycle(btn, button, timer_now_us());
+        }
+        else if (button->keycode != 0)
         {
             GPTK2_DEBUG("PRESSED '%s' -> '%s'\n", gbtn_names[btn], find_keycode(button->keycode));
             emitKey(button->keycode, true, button->modifier);
@@ -438,6 +874,9 @@ void update_button(int btn, bool pressed)
     }
     else if (was_released(btn))
     {
+        if (current_state.radial_menu_btn == btn)
+            radial_menu_close();
+
         button = state_button(btn);
 
         if (button == NULL)
@@ -456,7 +895,16 @@ void update_button(int btn, bool pressed)
         current_state.mouse_move &= ~btn_mask;
         current_state.in_repeat  &= ~btn_mask;
 
-        if (button->keycode != 0)
+        if ((current_state.in_pwm & btn_mask) != 0)
+        {
+            pwm_set_output(btn, button, false);
+            current_state.in_pwm &= ~btn_mask;
+        }
+        else if (current_state.zone_level[btn] != 0)
+        {
+            zone_release(btn, button);
+        }
+        else if (button->keycode != 0)
         {
             GPTK2_DEBUG("RELEASE '%s' -> '%s'\n", gbtn_names[btn], find_keycode(button->keycode));
             emitKey(button->keycode, false, button->modifier);
@@ -0,0 +1,169 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb2.h"
+
+/* Touchpad to mouse.
+ *
+ * One finger moves the mouse, two fingers scroll. Touch events only add to
+ * an accumulator, it is turned into mouse movement on the mouse tick so a
+ * fast touch stream does not mean a write per touch event.
+ */
+
+#define TOUCHPAD_FINGERS 4
+// Keep the mouse tick going this long (us) after the last movement.
+#define TOUCHPAD_IDLE_US 100000
+
+typedef struct
+{
+    bool down;
+    float x;
+    float y;
+} touchpad_finger;
+
+static touchpad_finger touchpad_fingers[TOUCHPAD_FINGERS];
+static int touchpad_fingers_down = 0;
+
+// in touchpad widths / heights
+static float touchpad_accum_x = 0.0f;
+static float touchpad_accum_y = 0.0f;
+static float touchpad_scroll_x = 0.0f;
+static float touchpad_scroll_y = 0.0f;
+
+static Uint64 touchpad_moving_until_us = 0;
+
+
+void touchpad_event(const SDL_Event *event)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    if (!current_state.touchpad_mouse)
+        return;
+
+    // only the first touchpad, and only the fingers we track.
+    if (event->ctouchpad.touchpad != 0 ||
+        event->ctouchpad.finger < 0 || event->ctouchpad.finger >= TOUCHPAD_FINGERS)
+        return;
+
+    touchpad_finger *finger = &touchpad_fingers[event->ctouchpad.finger];
+
+    switch (event->type)
+    {
+    case SDL_CONTROLLERTOUCHPADDOWN:
+        if (!finger->down)
+            touchpad_fingers_down++;
+
+        finger->down = true;
+        finger->x = event->ctouchpad.x;
+        finger->y = event->ctouchpad.y;
+        break;
+
+    case SDL_CONTROLLERTOUCHPADMOTION:
+        if (!finger->down)
+            break;
+
+        if (touchpad_fingers_down == 1)
+        {
+            touchpad_accum_x += event->ctouchpad.x - finger->x;
+            touchpad_accum_y += event->ctouchpad.y - finger->y;
+        }
+        else if (touchpad_fingers_down == 2)
+        {   // both fingers report motion, so each counts for half.
+            touchpad_scroll_x += (event->ctouchpad.x - finger->x) * 0.5f;
+            touchpad_scroll_y += (event->ctouchpad.y - finger->y) * 0.5f;
+        }
+
+        if (event->ctouchpad.x != finger->x || event->ctouchpad.y != finger->y)
+            touchpad_moving_until_us = timer_now_us() + TOUCHPAD_IDLE_US;
+
+        finger->x = event->ctouchpad.x;
+        finger->y = event->ctouchpad.y;
+        break;
+
+    case SDL_CONTROLLERTOUCHPADUP:
+        if (finger->down)
+            touchpad_fingers_down--;
+
+        finger->down = false;
+        break;
+    }
+#endif
+}
+
+
+bool touchpad_active()
+{   // a finger resting on the pad doesn't count, only movement that still has to go out.
+    if (touchpad_accum_x != 0.0f || touchpad_accum_y != 0.0f ||
+        touchpad_scroll_x != 0.0f || touchpad_scroll_y != 0.0f)
+        return true;
+
+    return (touchpad_moving_until_us != 0 && timer_now_us() < touchpad_moving_until_us);
+}
+
+
+void touchpad_take(float *x, float *y, float dt)
+{   // hand the built up movement to the mouse tick, in pixels.
+    if (touchpad_accum_x == 0.0f && touchpad_accum_y == 0.0f)
+        return;
+
+    float scale = (float)(current_state.touchpad_scale);
+
+    if (current_state.touchpad_accel > 0 && dt > 0.0f)
+    {   // faster swipes go further, speed is in touchpads per second.
+        vector2d move;
+
+        vector2d_set_float2(&move, touchpad_accum_x, touchpad_accum_y);
+
+        scale *= 1.0f + (vector2d_magnitude(&move) / dt) * ((float)(current_state.touchpad_accel) / 100.0f);
+    }
+
+    *x += touchpad_accum_x * scale;
+    *y += touchpad_accum_y * scale;
+
+    touchpad_accum_x = 0.0f;
+    touchpad_accum_y = 0.0f;
+}
+
+
+void touchpad_take_scroll(float *wheel, float *hwheel)
+{   // in REL_WHEEL_HI_RES units, dragging down scrolls down.
+    *wheel  -= touchpad_scroll_y * (float)(current_state.touchpad_scroll_scale * MOUSE_WHEEL_DETENT);
+    *hwheel += touchpad_scroll_x * (float)(current_state.touchpad_scroll_scale * MOUSE_WHEEL_DETENT);
+
+    touchpad_scroll_x = 0.0f;
+    touchpad_scroll_y = 0.0f;
+}
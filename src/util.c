@@ -287,39 +287,172 @@ int strncasecmp(const char *s1, const char *s2, size_t n)
 }
 
 
+/* Output frames.
+ *
+ * Events for the main device are collected until the SYN_REPORT that ends
+ * the frame, then the whole frame goes to the output engine in output.c.
+ */
+
+static struct input_event emit_frame[OUTPUT_FRAME_MAX];
+static int emit_frame_count = 0;
+
+
+// how long userspace gets to read the last events before the device goes away.
+#define EMIT_DRAIN_US 100000
+
+static Uint64 emit_last_us = 0;
+
+
+int uinput_create(int fd, const struct uinput_user_dev *device)
+{   /* Creates the device set up in device.
+     *
+     * UI_DEV_SETUP / UI_ABS_SETUP is the current way to do this, kernels
+     * before 4.5 don't have it so fall back to writing the whole device.
+     */
+#ifdef UI_DEV_SETUP
+    struct uinput_setup setup;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.id = device->id;
+    setup.ff_effects_max = device->ff_effects_max;
+    strncpy(setup.name, device->name, UINPUT_MAX_NAME_SIZE - 1);
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) == 0)
+    {
+        for (int axis=0; axis < ABS_CNT; axis++)
+        {
+            if (device->absmin[axis] == 0 && device->absmax[axis] == 0)
+                continue;
+
+            struct uinput_abs_setup abs_setup;
+
+            memset(&abs_setup, 0, sizeof(abs_setup));
+            abs_setup.code = axis;
+            abs_setup.absinfo.minimum = device->absmin[axis];
+            abs_setup.absinfo.maximum = device->absmax[axis];
+            abs_setup.absinfo.fuzz = device->absfuzz[axis];
+            abs_setup.absinfo.flat = device->absflat[axis];
+
+            if (ioctl(fd, UI_ABS_SETUP, &abs_setup) != 0)
+                return -1;
+        }
+
+        return ioctl(fd, UI_DEV_CREATE);
+    }
+#endif
+
+    if (write(fd, device, sizeof(*device)) != sizeof(*device))
+        return -1;
+
+    return ioctl(fd, UI_DEV_CREATE);
+}
+
+
+void emit_flush()
+{
+    if (emit_frame_count == 0)
+        return;
+
+    output_write(emit_frame, emit_frame_count);
+    emit_frame_count = 0;
+    emit_last_us = timer_now_us();
+}
+
+
+void emit_drain()
+{   // instead of a fixed sleep, only wait if something was sent recently.
+    emit_flush();
+    output_submit();
+
+    if (emit_last_us == 0)
+        return;
+
+    Uint64 deadline_us = emit_last_us + EMIT_DRAIN_US;
+
+    if (timer_now_us() < deadline_us)
+        timer_sleep_until(deadline_us);
+}
+
+
 void emit(int type, int code, int val)
 {
-    struct input_event ev;
+    struct input_event *ev = &emit_frame[emit_frame_count++];
 
-    ev.type = type;
-    ev.code = code;
-    ev.value = val;
+    ev->type = type;
+    ev->code = code;
+    ev->value = val;
     /* timestamp values below are ignored */
-    ev.time.tv_sec = 0;
-    ev.time.tv_usec = 0;
+    ev->time.tv_sec = 0;
+    ev->time.tv_usec = 0;
 
-    write(uinp_fd, &ev, sizeof(ev));
+    if ((type == EV_SYN && code == SYN_REPORT) || emit_frame_count >= OUTPUT_FRAME_MAX)
+        emit_flush();
 }
 
 
-void emitModifier(bool pressed, int modifier)
+/* Key state.
+ *
+ * Several buttons can be bound to the same key, and the modifiers are shared
+ * by every binding with add_shift / add_ctrl / add_alt. Each keycode counts
+ * how many held things want it down, only the 0 -> 1 and 1 -> 0 changes are
+ * sent. So letting go of one of two buttons bound to "up" keeps up held, and
+ * the second press isn't sent twice.
+ */
+
+static Uint8 emit_key_count[KEY_MAX + 1];
+static Uint32 emit_suppressed_presses = 0;
+static Uint32 emit_suppressed_releases = 0;
+
+static const struct
 {
-    if ((modifier & MOD_SHIFT) != 0)
+    int modifier;
+    int keycode;
+} emit_modifiers[] = {
+    {MOD_SHIFT, KEY_LEFTSHIFT},
+    {MOD_CTRL,  KEY_LEFTCTRL},
+    {MOD_ALT,   KEY_LEFTALT},
+};
+
+#define EMIT_MODIFIERS_MAX (sizeof(emit_modifiers) / sizeof(emit_modifiers[0]))
+
+
+static void emit_key_edge(int code, bool pressed)
+{   // doesn't end the frame.
+    if (code < 0 || code > KEY_MAX)
+        return;
+
+    if (pressed)
     {
-        emit(EV_KEY, KEY_LEFTSHIFT, pressed ? 1 : 0);
-        emit(EV_SYN, SYN_REPORT, 0);        
-    }
+        if (emit_key_count[code] == 0)
+            emit(EV_KEY, code, 1);
+        else
+            emit_suppressed_presses++;
 
-    if ((modifier & MOD_ALT) != 0)
+        if (emit_key_count[code] < 255)
+            emit_key_count[code]++;
+    }
+    else
     {
-        emit(EV_KEY, KEY_LEFTALT, pressed ? 1 : 0);
-        emit(EV_SYN, SYN_REPORT, 0);        
+        if (emit_key_count[code] == 0)
+        {   // already up.
+            emit_suppressed_releases++;
+            return;
+        }
+
+        if (--emit_key_count[code] == 0)
+            emit(EV_KEY, code, 0);
+        else
+            emit_suppressed_releases++;
     }
+}
 
-    if ((modifier & MOD_CTRL) != 0)
+
+void emitModifier(bool pressed, int modifier)
+{   // doesn't end the frame, the key that goes with it does that.
+    for (size_t i=0; i < EMIT_MODIFIERS_MAX; i++)
     {
-        emit(EV_KEY, KEY_LEFTCTRL, pressed ? 1 : 0);
-        emit(EV_SYN, SYN_REPORT, 0);        
+        if ((modifier & emit_modifiers[i].modifier) != 0)
+            emit_key_edge(emit_modifiers[i].keycode, pressed);
     }
 }
 
@@ -332,30 +465,54 @@ void emitKey(int code, bool pressed, int modifier)
     if ((modifier != 0) && pressed)
         emitModifier(pressed, modifier);
 
-    emit(EV_KEY, code, pressed ? 1 : 0);
-    emit(EV_SYN, SYN_REPORT, 0);
+    emit_key_edge(code, pressed);
 
     if ((modifier != 0) && !(pressed))
         emitModifier(pressed, modifier);
+
+    // nothing changed, nothing to send.
+    if (emit_frame_count > 0)
+        emit(EV_SYN, SYN_REPORT, 0);
+}
+
+
+void emit_release_all()
+{   // lets go of anything still held, so nothing is stuck down when the device goes away.
+    for (int code=0; code <= KEY_MAX; code++)
+    {
+        if (emit_key_count[code] == 0)
+            continue;
+
+        emit(EV_KEY, code, 0);
+        emit_key_count[code] = 0;
+    }
+
+    if (emit_frame_count > 0)
+        emit(EV_SYN, SYN_REPORT, 0);
+}
+
+
+void emit_report()
+{   // how many presses and releases were dropped because the key was already in that state.
+    if (emit_suppressed_presses == 0 && emit_suppressed_releases == 0)
+        return;
+
+    printf("keys: suppressed %u repeated presses and %u early releases\n",
+        emit_suppressed_presses, emit_suppressed_releases);
 }
 
 
 void emitTextInputKey(int code, bool uppercase)
 {
-    if (uppercase)
-    {   //capitalise capital letters by holding shift
-        emitKey(KEY_LEFTSHIFT, true, 0);
-    }
+    //capitalise capital letters by holding shift
+    int modifier = (uppercase ? MOD_SHIFT : 0);
 
-    emitKey(code, true, 0);
+    emitKey(code, true, modifier);
+    output_submit();
     SDL_Delay(16);
-    emitKey(code, false, 0);
+    emitKey(code, false, modifier);
+    output_submit();
     SDL_Delay(16);
-
-    if (uppercase)
-    {   //release shift if held
-        emitKey(KEY_LEFTSHIFT, false, 0);
-    }
 }
 
 
@@ -383,6 +540,43 @@ void emitMouseMotion(int x, int y)
     }
 }
 
+void emitMouseReport(int x, int y, int wheel, int hwheel, int wheel_hi_res, int hwheel_hi_res)
+{   /* motion and wheel in one frame, so a mouse tick is one report.
+     * wheel / hwheel are whole clicks for older programs, the hi res values are in 1/120ths of a click.
+     */
+    if (x != 0)
+    {
+        emit(EV_REL, REL_X, x);
+    }
+    if (y != 0)
+    {
+        emit(EV_REL, REL_Y, y);
+    }
+#ifdef REL_WHEEL_HI_RES
+    if (wheel_hi_res != 0)
+    {
+        emit(EV_REL, REL_WHEEL_HI_RES, wheel_hi_res);
+    }
+    if (hwheel_hi_res != 0)
+    {
+        emit(EV_REL, REL_HWHEEL_HI_RES, hwheel_hi_res);
+    }
+#endif
+    if (wheel != 0)
+    {
+        emit(EV_REL, REL_WHEEL, wheel);
+    }
+    if (hwheel != 0)
+    {
+        emit(EV_REL, REL_HWHEEL, hwheel);
+    }
+
+    if (x != 0 || y != 0 || wheel != 0 || hwheel != 0 || wheel_hi_res != 0 || hwheel_hi_res != 0)
+    {
+        emit(EV_SYN, SYN_REPORT, 0);
+    }
+}
+
 void handleAnalogTrigger(bool is_triggered, bool *was_triggered, int key, int modifier)
 {
     if (is_triggered && !(*was_triggered))
@@ -473,11 +667,15 @@ bool process_with_kill(const char *process_name, bool use_sudo)
 
 bool process_with_pc_quit()
 {
-    emitKey(KEY_F4, true, KEY_LEFTALT);
+    emitKey(KEY_F4, true, MOD_ALT);
+    output_submit();
     SDL_Delay(15);
 
-    emitKey(KEY_F4, false, KEY_LEFTALT);
+    emitKey(KEY_F4, false, MOD_ALT);
+    output_submit();
     SDL_Delay(15);
+
+    return true;
 }
 
 
@@ -37,6 +37,458 @@
 
 #include "gptokeyb2.h"
 
+// only used in hybrid mode, otherwise the pad is the main device.
+int xbox_fd = -1;
+
+/* Axis tables.
+ *
+ * Sticks and triggers go through deadzone, anti-deadzone, curve and trigger
+ * range before they reach the pad. That's all worked out in xbox_finalise()
+ * for every possible input value, so each event is just a lookup. Values that
+ * come out the same as last time aren't sent at all, which gets rid of most
+ * of the noise from a resting stick.
+ */
+
+#define XBOX_AXIS_NONE -100000
+
+static Sint16 xbox_stick_lut[2][65536];
+static Sint16 xbox_trigger_lut[32768];
+static int xbox_last_value[ABS_CNT];
+
+/* Routing.
+ *
+ * Every physical button and axis has one entry in xbox_routes, indexed by the
+ * SDL button, or SDL_CONTROLLER_BUTTON_MAX + the SDL axis. The [xbox] section
+ * fills it in while the config loads, so an event is one lookup and a small
+ * switch on how the value gets changed:
+ *
+ *  - PRESS      button to button / dpad / stick direction / trigger.
+ *  - STICK      axis to stick axis, through the stick table.
+ *  - TRIGGER    axis to trigger, through the trigger table.
+ *  - THRESHOLD  axis to button / dpad / stick direction, once it's pushed far enough.
+ */
+
+#define XBOX_AXIS(axis) (SDL_CONTROLLER_BUTTON_MAX + (axis))
+#define XBOX_IN_MAX XBOX_AXIS(SDL_CONTROLLER_AXIS_MAX)
+
+#define XBOX_XFORM_NONE      0
+#define XBOX_XFORM_PRESS     1
+#define XBOX_XFORM_STICK     2
+#define XBOX_XFORM_TRIGGER   3
+#define XBOX_XFORM_THRESHOLD 4
+
+#define XBOX_LUT_LEFT  0
+#define XBOX_LUT_RIGHT 1
+#define XBOX_LUT_RAW   2
+
+typedef struct
+{
+    const char *name;
+    int input;
+} xbox_input_match;
+
+typedef struct
+{
+    const char *name;
+    Uint16 type;
+    Uint16 code;
+    Sint16 value;   // sent on press, or the full range for analog outputs
+    bool analog;
+} xbox_output_match;
+
+typedef struct
+{
+    Uint8 transform;
+    Uint8 lut;
+    Uint8 output;
+    bool invert;
+    Uint16 type;
+    Uint16 code;
+    Sint16 value;
+    Sint16 threshold;
+} xbox_route;
+
+static const xbox_input_match xbox_inputs[] = {
+    {"a", SDL_CONTROLLER_BUTTON_A},
+    {"b", SDL_CONTROLLER_BUTTON_B},
+    {"x", SDL_CONTROLLER_BUTTON_X},
+    {"y", SDL_CONTROLLER_BUTTON_Y},
+
+    {"l1", SDL_CONTROLLER_BUTTON_LEFTSHOULDER},
+    {"l3", SDL_CONTROLLER_BUTTON_LEFTSTICK},
+    {"r1", SDL_CONTROLLER_BUTTON_RIGHTSHOULDER},
+    {"r3", SDL_CONTROLLER_BUTTON_RIGHTSTICK},
+
+    {"start",  SDL_CONTROLLER_BUTTON_START},
+    {"back",   SDL_CONTROLLER_BUTTON_BACK},
+    {"select", SDL_CONTROLLER_BUTTON_BACK},
+    {"guide",  SDL_CONTROLLER_BUTTON_GUIDE},
+
+    {"up",    SDL_CONTROLLER_BUTTON_DPAD_UP},
+    {"down",  SDL_CONTROLLER_BUTTON_DPAD_DOWN},
+    {"left",  SDL_CONTROLLER_BUTTON_DPAD_LEFT},
+    {"right", SDL_CONTROLLER_BUTTON_DPAD_RIGHT},
+
+    {"left_analog_x",  XBOX_AXIS(SDL_CONTROLLER_AXIS_LEFTX)},
+    {"left_analog_y",  XBOX_AXIS(SDL_CONTROLLER_AXIS_LEFTY)},
+    {"right_analog_x", XBOX_AXIS(SDL_CONTROLLER_AXIS_RIGHTX)},
+    {"right_analog_y", XBOX_AXIS(SDL_CONTROLLER_AXIS_RIGHTY)},
+
+    {"l2", XBOX_AXIS(SDL_CONTROLLER_AXIS_TRIGGERLEFT)},
+    {"r2", XBOX_AXIS(SDL_CONTROLLER_AXIS_TRIGGERRIGHT)},
+};
+
+static const xbox_output_match xbox_outputs[] = {
+    {"none", 0, 0, 0, false},
+
+    {"a", EV_KEY, BTN_A, 1, false},
+    {"b", EV_KEY, BTN_B, 1, false},
+    {"x", EV_KEY, BTN_X, 1, false},
+    {"y", EV_KEY, BTN_Y, 1, false},
+
+    {"l1", EV_KEY, BTN_TL,     1, false},
+    {"l3", EV_KEY, BTN_THUMBL, 1, false},
+    {"r1", EV_KEY, BTN_TR,     1, false},
+    {"r3", EV_KEY, BTN_THUMBR, 1, false},
+
+    {"start",  EV_KEY, BTN_START,  1, false},
+    {"back",   EV_KEY, BTN_SELECT, 1, false},
+    {"select", EV_KEY, BTN_SELECT, 1, false},
+    {"guide",  EV_KEY, BTN_MODE,   1, false},
+
+    {"up",    EV_ABS, ABS_HAT0Y, -1, false},
+    {"down",  EV_ABS, ABS_HAT0Y,  1, false},
+    {"left",  EV_ABS, ABS_HAT0X, -1, false},
+    {"right", EV_ABS, ABS_HAT0X,  1, false},
+
+    {"left_analog_x",  EV_ABS, ABS_X,  32767, true},
+    {"left_analog_y",  EV_ABS, ABS_Y,  32767, true},
+    {"right_analog_x", EV_ABS, ABS_RX, 32767, true},
+    {"right_analog_y", EV_ABS, ABS_RY, 32767, true},
+
+    {"left_analog_up",     EV_ABS, ABS_Y,  -32767, false},
+    {"left_analog_down",   EV_ABS, ABS_Y,   32767, false},
+    {"left_analog_left",   EV_ABS, ABS_X,  -32767, false},
+    {"left_analog_right",  EV_ABS, ABS_X,   32767, false},
+
+    {"right_analog_up",    EV_ABS, ABS_RY, -32767, false},
+    {"right_analog_down",  EV_ABS, ABS_RY,  32767, false},
+    {"right_analog_left",  EV_ABS, ABS_RX, -32767, false},
+    {"right_analog_right", EV_ABS, ABS_RX,  32767, false},
+
+    {"l2", EV_ABS, ABS_Z,  255, true},
+    {"r2", EV_ABS, ABS_RZ, 255, true},
+};
+
+// what you get without an [xbox] section, the same name in and out.
+static const char *xbox_default_routes[] = {
+    "a", "b", "x", "y", "l1", "l3", "r1", "r3", "start", "back", "guide",
+    "up", "down", "left", "right",
+    "left_analog_x", "left_analog_y", "right_analog_x", "right_analog_y", "l2", "r2",
+};
+
+#define XBOX_INPUTS_COUNT ((int)(sizeof(xbox_inputs) / sizeof(xbox_inputs[0])))
+#define XBOX_OUTPUTS_COUNT ((int)(sizeof(xbox_outputs) / sizeof(xbox_outputs[0])))
+#define XBOX_DEFAULT_ROUTES_COUNT ((int)(sizeof(xbox_default_routes) / sizeof(xbox_default_routes[0])))
+
+static xbox_route xbox_routes[XBOX_IN_MAX];
+static bool xbox_route_active[XBOX_IN_MAX];
+static bool xbox_routes_ready = false;
+
+
+static void xbox_emit(int type, int code, int value)
+{   // one frame, in hybrid mode it goes to the pad device.
+    if (!hybrid_mode)
+    {
+        emit(type, code, value);
+        emit(EV_SYN, SYN_REPORT, 0);
+        return;
+    }
+
+    struct input_event events[2];
+
+    memset(events, 0, sizeof(events));
+    events[0].type = type;
+    events[0].code = code;
+    events[0].value = value;
+    events[1].type = EV_SYN;
+    events[1].code = SYN_REPORT;
+    events[1].value = 0;
+
+    output_write_device(OUTPUT_DEVICE_PAD, events, 2);
+}
+
+
+static void xbox_emit_key(int code, bool pressed)
+{
+    if (!hybrid_mode)
+    {
+        emitKey(code, pressed, 0);
+        return;
+    }
+
+    xbox_emit(EV_KEY, code, (pressed ? 1 : 0));
+}
+
+
+static void xbox_emit_axis(int code, int value)
+{
+    if (xbox_last_value[code] == value)
+        return;
+
+    xbox_last_value[code] = value;
+    xbox_emit(EV_ABS, code, value);
+}
+
+
+static int xbox_stick_value(int value, int deadzone)
+{
+    int anti = current_state.xbox_anti_deadzone;
+    int magnitude = abs(value);
+
+    if (magnitude > 32767)
+        magnitude = 32767;
+
+    if (magnitude <= deadzone)
+        return 0;
+
+    float amount = (float)(magnitude - deadzone) / (float)(32767 - deadzone);
+
+    if (current_state.xbox_curve != 100)
+        amount = powf(amount, (float)(current_state.xbox_curve) / 100.0f);
+
+    int result = (int)((float)(anti) + amount * (float)(32767 - anti) + 0.5f);
+
+    if (result > 32767)
+        result = 32767;
+
+    return ((value < 0) ? -result : result);
+}
+
+
+static int xbox_trigger_value(int value)
+{   // 0 .. 32767 in, 0 .. 255 out.
+    int low = current_state.xbox_trigger_deadzone;
+    int high = current_state.xbox_trigger_max;
+
+    if (value <= low)
+        return 0;
+
+    if (value >= high || high <= low)
+        return 255;
+
+    return ((value - low) * 255 + (high - low) / 2) / (high - low);
+}
+
+
+static int xbox_find_input(const char *name)
+{
+    for (int i=0; i < XBOX_INPUTS_COUNT; i++)
+    {
+        if (strcasecmp(xbox_inputs[i].name, name) == 0)
+            return xbox_inputs[i].input;
+    }
+
+    return -1;
+}
+
+
+static int xbox_find_output(const char *name)
+{
+    for (int i=0; i < XBOX_OUTPUTS_COUNT; i++)
+    {
+        if (strcasecmp(xbox_outputs[i].name, name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+
+static void xbox_set_route(int input, int output, bool invert, int threshold)
+{   // works out how the value gets changed now, so events don't have to.
+    const xbox_output_match *match = &xbox_outputs[output];
+    xbox_route *route = &xbox_routes[input];
+    int axis = input - SDL_CONTROLLER_BUTTON_MAX;
+
+    memset(route, 0, sizeof(xbox_route));
+
+    route->output = output;
+    route->type = match->type;
+    route->code = match->code;
+    route->value = match->value;
+    route->threshold = threshold;
+    route->invert = (invert && axis >= 0);
+
+    if (match->type == 0)
+        route->transform = XBOX_XFORM_NONE;
+
+    else if (axis < 0)
+        route->transform = XBOX_XFORM_PRESS;
+
+    else if (!match->analog)
+        route->transform = XBOX_XFORM_THRESHOLD;
+
+    else if (match->code == ABS_Z || match->code == ABS_RZ)
+        route->transform = XBOX_XFORM_TRIGGER;
+
+    else
+        route->transform = XBOX_XFORM_STICK;
+
+    if (axis == SDL_CONTROLLER_AXIS_LEFTX || axis == SDL_CONTROLLER_AXIS_LEFTY)
+        route->lut = XBOX_LUT_LEFT;
+
+    else if (axis == SDL_CONTROLLER_AXIS_RIGHTX || axis == SDL_CONTROLLER_AXIS_RIGHTY)
+        route->lut = XBOX_LUT_RIGHT;
+
+    else
+        route->lut = XBOX_LUT_RAW;
+}
+
+
+static void xbox_routes_reset()
+{
+    int none = xbox_find_output("none");
+
+    for (int input=0; input < XBOX_IN_MAX; input++)
+    {
+        xbox_set_route(input, none, false, 0);
+        xbox_route_active[input] = false;
+    }
+
+    for (int i=0; i < XBOX_DEFAULT_ROUTES_COUNT; i++)
+    {
+        xbox_set_route(
+            xbox_find_input(xbox_default_routes[i]),
+            xbox_find_output(xbox_default_routes[i]),
+            false, 0);
+    }
+
+    xbox_routes_ready = true;
+}
+
+
+void xbox_config(const char *name, const char *value)
+{   // one line from [xbox], "l2 = a threshold 0.5"
+    if (!xbox_routes_ready)
+        xbox_routes_reset();
+
+    int input = xbox_find_input(name);
+
+    if (input < 0)
+    {
+        fprintf(stderr, "error: xbox: unknown input %s\n", name);
+        return;
+    }
+
+    char *temp_buffer = tabulate_text(value);
+
+    if (temp_buffer == NULL)
+        return;
+
+    token_ctx *token_state = tokens_create(temp_buffer, '\t');
+    free(temp_buffer);
+
+    const char *token = tokens_next(token_state);
+    int output = ((token != NULL) ? xbox_find_output(token) : -1);
+
+    if (output < 0)
+    {
+        fprintf(stderr, "error: xbox: %s: unknown output %s\n", name, ((token != NULL) ? token : ""));
+        tokens_free(token_state);
+        return;
+    }
+
+    bool invert = false;
+    int threshold = 16384;
+
+    token = tokens_next(token_state);
+    while (token != NULL)
+    {
+        if (strcasecmp(token, "invert") == 0)
+        {
+            invert = true;
+        }
+        else if (strcasecmp(token, "threshold") == 0)
+        {
+            token = tokens_next(token_state);
+
+            float amount = ((token != NULL) ? atof(token) : 0.0f);
+
+            if (amount == 0.0f || amount < -1.0f || amount > 1.0f)
+                fprintf(stderr, "error: xbox: %s: threshold needs to be between -1 and 1\n", name);
+            else
+                threshold = (int)(amount * 32767.0f);
+        }
+        else if (strlen(token) > 0)
+        {
+            fprintf(stderr, "error: xbox: %s: unknown option %s\n", name, token);
+        }
+
+        if (token == NULL)
+            break;
+
+        token = tokens_next(token_state);
+    }
+
+    tokens_free(token_state);
+
+    xbox_set_route(input, output, invert, threshold);
+}
+
+
+void xbox_dump()
+{
+    if (!xbox_routes_ready)
+        xbox_routes_reset();
+
+    printf("[xbox]\n");
+
+    for (int i=0; i < XBOX_INPUTS_COUNT; i++)
+    {
+        // skip aliases
+        if (i > 0 && xbox_inputs[i].input == xbox_inputs[i-1].input)
+            continue;
+
+        const xbox_route *route = &xbox_routes[xbox_inputs[i].input];
+
+        printf("%s = %s", xbox_inputs[i].name, xbox_outputs[route->output].name);
+
+        if (route->invert)
+            printf(" invert");
+
+        if (route->transform == XBOX_XFORM_THRESHOLD)
+            printf(" threshold %.2f", (float)(route->threshold) / 32767.0f);
+
+        printf("\n");
+    }
+
+    printf("\n");
+}
+
+
+void xbox_finalise()
+{   // compile the axis tables once the config is loaded.
+    if (!xbox_routes_ready)
+        xbox_routes_reset();
+
+    if (!xbox360_mode && !hybrid_mode)
+        return;
+
+    for (int value=-32768; value <= 32767; value++)
+    {
+        xbox_stick_lut[0][value + 32768] = xbox_stick_value(value, current_state.xbox_left_deadzone);
+        xbox_stick_lut[1][value + 32768] = xbox_stick_value(value, current_state.xbox_right_deadzone);
+    }
+
+    for (int value=0; value <= 32767; value++)
+        xbox_trigger_lut[value] = xbox_trigger_value(value);
+
+    for (int code=0; code < ABS_CNT; code++)
+        xbox_last_value[code] = XBOX_AXIS_NONE;
+}
+
+
 void UINPUT_SET_ABS_P(
     struct uinput_user_dev* dev,
     int axis,
@@ -92,100 +544,73 @@ void setupFakeXbox360Device(struct uinput_user_dev *device, int fd)
 }
 
 
-void handleEventBtnFakeXbox360Device(const SDL_Event *event, bool is_pressed)
+static void xbox_route_output(const xbox_route *route, int value)
 {
-    // Fake Xbox360 mode
-    switch (event->cbutton.button) {
-    case SDL_CONTROLLER_BUTTON_A:
-        emitKey(BTN_A, is_pressed, 0);
-        break;
+    if (route->type == EV_KEY)
+        xbox_emit_key(route->code, (value != 0));
+    else
+        xbox_emit_axis(route->code, value);
+}
 
-    case SDL_CONTROLLER_BUTTON_B:
-        emitKey(BTN_B, is_pressed, 0);
-        break;
 
-    case SDL_CONTROLLER_BUTTON_X:
-        emitKey(BTN_X, is_pressed, 0);
-        break;
+static void xbox_route_value(int input, int value)
+{   // value is 0 / 1 for buttons, the raw value for axes.
+    const xbox_route *route = &xbox_routes[input];
 
-    case SDL_CONTROLLER_BUTTON_Y:
-        emitKey(BTN_Y, is_pressed, 0);
-        break;
+    if (route->invert)
+        value = ((value <= -32767) ? 32767 : -value);
 
-    case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
-        emitKey(BTN_TL, is_pressed, 0);
+    switch (route->transform)
+    {
+    case XBOX_XFORM_PRESS:
+        xbox_route_output(route, (value ? route->value : 0));
         break;
 
-    case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
-        emitKey(BTN_TR, is_pressed, 0);
+    case XBOX_XFORM_STICK:
+        if (route->lut == XBOX_LUT_RAW)
+            xbox_route_output(route, value);
+        else
+            xbox_route_output(route, xbox_stick_lut[route->lut][value + 32768]);
         break;
 
-    case SDL_CONTROLLER_BUTTON_LEFTSTICK:
-        emitKey(BTN_THUMBL, is_pressed, 0);
+    case XBOX_XFORM_TRIGGER:
+        // The target range for the triggers is 0..255 instead of
+        // 0..32767, xbox_trigger_value() does the scaling.
+        xbox_route_output(route, xbox_trigger_lut[(value < 0) ? 0 : value]);
         break;
 
-    case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
-        emitKey(BTN_THUMBR, is_pressed, 0);
-        break;
+    case XBOX_XFORM_THRESHOLD:
+        {
+            bool active = ((route->threshold >= 0) ? (value >= route->threshold) : (value <= route->threshold));
 
-    case SDL_CONTROLLER_BUTTON_BACK: // aka select
-        emitKey(BTN_SELECT, is_pressed, 0);
-        break;
+            if (active == xbox_route_active[input])
+                break;
 
-    case SDL_CONTROLLER_BUTTON_GUIDE:
-        emitKey(BTN_MODE, is_pressed, 0);
-        break;
-
-    case SDL_CONTROLLER_BUTTON_START:
-        emitKey(BTN_START, is_pressed, 0);
+            xbox_route_active[input] = active;
+            xbox_route_output(route, (active ? route->value : 0));
+        }
         break;
+    }
+}
 
-    case SDL_CONTROLLER_BUTTON_DPAD_UP:
-        emitAxisMotion(ABS_HAT0Y, is_pressed ? -1 : 0);
-        break;
 
-    case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-        emitAxisMotion(ABS_HAT0Y, is_pressed ? 1 : 0);
-        break;
+void handleEventBtnFakeXbox360Device(const SDL_Event *event, bool is_pressed)
+{
+    int input = event->cbutton.button;
 
-    case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-        emitAxisMotion(ABS_HAT0X, is_pressed ? -1 : 0);
-        break;
+    if (input < 0 || input >= SDL_CONTROLLER_BUTTON_MAX)
+        return;
 
-    case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-        emitAxisMotion(ABS_HAT0X, is_pressed ? 1 : 0);
-        break;
-    }
+    xbox_route_value(input, (is_pressed ? 1 : 0));
 }
 
+
 void handleEventAxisFakeXbox360Device(const SDL_Event *event)
 {
-    switch (event->caxis.axis) {
-    case SDL_CONTROLLER_AXIS_LEFTX:
-        emitAxisMotion(ABS_X, event->caxis.value);
-        break; 
+    int axis = event->caxis.axis;
 
-    case SDL_CONTROLLER_AXIS_LEFTY:
-        emitAxisMotion(ABS_Y, event->caxis.value);
-        break;
-
-    case SDL_CONTROLLER_AXIS_RIGHTX:
-        emitAxisMotion(ABS_RX, event->caxis.value);
-        break;
-
-    case SDL_CONTROLLER_AXIS_RIGHTY:
-        emitAxisMotion(ABS_RY, event->caxis.value);
-        break;
+    if (axis < 0 || axis >= SDL_CONTROLLER_AXIS_MAX)
+        return;
 
-    case SDL_CONTROLLER_AXIS_TRIGGERLEFT:
-        // The target range for the triggers is 0..255 instead of
-        // 0..32767, so we shift down by 7 as that does exactly the
-        // scaling we need (32767 >> 7 is 255)
-        emitAxisMotion(ABS_Z, event->caxis.value >> 7);
-        break;
-
-    case SDL_CONTROLLER_AXIS_TRIGGERRIGHT:
-        emitAxisMotion(ABS_RZ, event->caxis.value >> 7);
-        break;
-    }
+    xbox_route_value(XBOX_AXIS(axis), event->caxis.value);
 }
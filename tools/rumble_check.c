@@ -0,0 +1,239 @@
+/* Copyright (c) 2021-2024
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+/* Rumble check.
+ *
+ * Talks to the fake Xbox 360 pad like a game would: uploads an FF_RUMBLE
+ * effect, plays it, stops it and erases it again. Each step is answered by
+ * the rumble thread in gptokeyb2, so if this hangs or fails that is where to
+ * look. The real controller should buzz while the effect plays.
+ *
+ *   rumble_check [/dev/input/eventX] [strong] [weak] [ms]
+ *
+ * Without a device it looks for the fake pad by name.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+#define RUMBLE_CHECK_NAME "Microsoft X-Box 360 pad"
+#define RUMBLE_CHECK_PATH_MAX 300
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define TEST_BIT(bit, array) ((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+
+static int find_pad(char *path, size_t path_size)
+{   // the first /dev/input/eventX with the fake pad's name.
+    DIR *dir = opendir("/dev/input");
+    struct dirent *entry;
+    int fd = -1;
+
+    if (dir == NULL)
+        return -1;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char name[256];
+
+        if (strncmp(entry->d_name, "event", 5) != 0)
+            continue;
+
+        snprintf(path, path_size, "/dev/input/%s", entry->d_name);
+
+        fd = open(path, O_RDWR);
+
+        if (fd < 0)
+            continue;
+
+        memset(name, 0, sizeof(name));
+
+        if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) >= 0 && strcmp(name, RUMBLE_CHECK_NAME) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+    }
+
+    closedir(dir);
+    return fd;
+}
+
+
+static int play(int fd, int id, int value)
+{
+    struct input_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = EV_FF;
+    ev.code = id;
+    ev.value = value;
+
+    return ((write(fd, &ev, sizeof(ev)) == sizeof(ev)) ? 0 : -1);
+}
+
+
+int main(int argc, char* argv[])
+{
+    char path[RUMBLE_CHECK_PATH_MAX];
+    unsigned long ff_bits[(FF_CNT + BITS_PER_LONG - 1) / BITS_PER_LONG];
+    struct ff_effect effect;
+    int strong = 0xC000;
+    int weak = 0x4000;
+    int length = 500;
+    int fd;
+
+    if (argc > 1)
+    {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+        fd = open(path, O_RDWR);
+    }
+    else
+    {
+        fd = find_pad(path, sizeof(path));
+    }
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "Unable to open the fake pad, is gptokeyb2 running with -x or -y?\n");
+        return 1;
+    }
+
+    if (argc > 2)
+        strong = atoi(argv[2]);
+
+    if (argc > 3)
+        weak = atoi(argv[3]);
+
+    if (argc > 4)
+        length = atoi(argv[4]);
+
+    printf("Using %s\n", path);
+
+    memset(ff_bits, 0, sizeof(ff_bits));
+
+    if (ioctl(fd, EVIOCGBIT(EV_FF, sizeof(ff_bits)), ff_bits) < 0 || !TEST_BIT(FF_RUMBLE, ff_bits))
+    {
+        fprintf(stderr, "FAIL: device has no FF_RUMBLE\n");
+        close(fd);
+        return 1;
+    }
+
+    // anything but rumble should be turned down.
+    memset(&effect, 0, sizeof(effect));
+    effect.type = FF_CONSTANT;
+    effect.id = -1;
+    effect.replay.length = (unsigned short)(length);
+
+    if (ioctl(fd, EVIOCSFF, &effect) == 0)
+    {
+        fprintf(stderr, "FAIL: FF_CONSTANT was accepted\n");
+        ioctl(fd, EVIOCRMFF, effect.id);
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: FF_CONSTANT turned down (%s)\n", strerror(errno));
+
+    memset(&effect, 0, sizeof(effect));
+    effect.type = FF_RUMBLE;
+    effect.id = -1;
+    effect.u.rumble.strong_magnitude = (unsigned short)(strong);
+    effect.u.rumble.weak_magnitude = (unsigned short)(weak);
+    effect.replay.length = (unsigned short)(length);
+
+    // this waits for the rumble thread to answer.
+    if (ioctl(fd, EVIOCSFF, &effect) < 0)
+    {
+        fprintf(stderr, "FAIL: upload: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: uploaded effect %d, strong %d weak %d for %d ms\n", effect.id, strong, weak, length);
+
+    if (play(fd, effect.id, 1) < 0)
+    {
+        fprintf(stderr, "FAIL: play: %s\n", strerror(errno));
+        ioctl(fd, EVIOCRMFF, effect.id);
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: playing\n");
+    usleep((useconds_t)(length) * 1000);
+
+    if (play(fd, effect.id, 0) < 0)
+    {
+        fprintf(stderr, "FAIL: stop: %s\n", strerror(errno));
+        ioctl(fd, EVIOCRMFF, effect.id);
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: stopped\n");
+
+    if (ioctl(fd, EVIOCRMFF, effect.id) < 0)
+    {
+        fprintf(stderr, "FAIL: erase: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: erased effect %d\n", effect.id);
+
+    // erasing twice should fail, the slot is free again.
+    if (ioctl(fd, EVIOCRMFF, effect.id) == 0)
+    {
+        fprintf(stderr, "FAIL: effect %d could be erased twice\n", effect.id);
+        close(fd);
+        return 1;
+    }
+
+    printf("ok: rumble works\n");
+
+    close(fd);
+    return 0;
+}